@@ -0,0 +1,32 @@
+#pragma once
+#include "capture.h"
+#include "decimate.h"
+#include "error.h"
+#include "fix.h"
+#include "log.h"
+#include "tables.h"
+
+#include <Arduino.h>
+
+/* CONSTANTS */
+#define DSP_ARENA_BUDGET (128 * 1024) // bytes of the 264KB of SRAM set aside for DSP buffers
+
+/* TYPES */
+// Every CAPTURE_DEPTH sized buffer in one block, so the footprint is fixed at link time
+typedef struct dsp_arena_t {
+    uint16_t capture[CAPTURE_RING_DEPTH][FFT_MAX_DEPTH]; // the mic DMA ring
+    uint16_t frame[2 * FFT_MAX_DEPTH];  // decimated samples waiting for a full frame, or the sliding history twice over
+    complex15 spectrum[FFT_MAX_DEPTH];  // FFT working set, real and imaginary parts side by side
+    fix15 window[FFT_MAX_DEPTH];        // current window at the current depth, ingest reads it every frame
+    uint16_t bit_reverse[FFT_MAX_DEPTH];
+} dsp_arena_t;
+
+#ifndef NATIVE_BUILD
+static_assert(sizeof(dsp_arena_t) <= DSP_ARENA_BUDGET, "DSP arena is over budget, lower FFT_MAX_BITS");
+#endif
+
+/* EXPORTED VARIABLES */
+extern dsp_arena_t dsp_arena;
+
+/* EXPORTED FUNCTIONS */
+uint32_t arena_report();
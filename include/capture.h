@@ -0,0 +1,49 @@
+#pragma once
+#include "error.h"
+#include "hardware/sync.h"
+
+#include <Arduino.h>
+
+/*
+ * Ring of mic capture buffers with explicit ownership. Each buffer is free, being filled
+ * by a DMA channel, ready with samples, or held by the DSP, and only ever one of those.
+ * The producer claims a buffer before the DMA writes to it and marks it filled after;
+ * the consumer acquires the oldest filled one and releases it when it's done. So the DMA
+ * never writes into a buffer the DSP is reading. When the DSP falls behind and nothing is
+ * free, the oldest ready buffer is taken back and counted as dropped.
+ */
+
+/* CONSTANTS */
+#define CAPTURE_RING_DEPTH 4 // buffers in the mic ring: two for the chained DMA channels, one held, one spare
+#define CAPTURE_RING_MIN   4 // each DMA channel always has one claimed, the DSP holds one, so one spare
+#define CAPTURE_RING_MAX   8
+#define CAPTURE_NONE       -1
+
+static_assert(CAPTURE_RING_DEPTH >= CAPTURE_RING_MIN, "CAPTURE_RING_DEPTH leaves no spare buffer");
+static_assert(CAPTURE_RING_DEPTH <= CAPTURE_RING_MAX, "CAPTURE_RING_DEPTH is deeper than a capture_ring_t holds");
+
+/* TYPES */
+enum capture_state_t { CAPTURE_FREE, CAPTURE_FILLING, CAPTURE_READY, CAPTURE_HELD };
+
+typedef struct capture_ring_t {
+    uint16_t *buffers[CAPTURE_RING_MAX];
+    volatile uint8_t state[CAPTURE_RING_MAX];
+    volatile uint32_t order[CAPTURE_RING_MAX]; // when each ready buffer was filled, oldest goes first
+    volatile uint32_t stamp[CAPTURE_RING_MAX]; // profile_now() it was filled at
+    uint8_t depth;
+
+    volatile uint32_t produced; // buffers filled
+    volatile uint32_t consumed; // buffers released by the DSP
+    volatile uint32_t dropped;  // filled but taken back before the DSP got to them
+} capture_ring_t;
+
+/* EXPORTED FUNCTIONS */
+// Producer side, from the DMA IRQ
+void capture_ring_init(capture_ring_t *ring, uint16_t *buffers[], uint8_t depth);
+int8_t capture_ring_claim(capture_ring_t *ring);
+void capture_ring_filled(capture_ring_t *ring, int8_t slot, uint32_t stamp);
+
+// Consumer side, from the DSP
+int8_t capture_ring_acquire(capture_ring_t *ring, uint32_t *stamp);
+void capture_ring_release(capture_ring_t *ring, int8_t slot);
+uint8_t capture_ring_pending(const capture_ring_t *ring);
@@ -1,5 +1,6 @@
 #pragma once
 #include "error.h"
+#include "log.h"
 #include "pico/stdlib.h"
 
 #include <Arduino.h>
@@ -0,0 +1,16 @@
+#pragma once
+#include "error.h"
+#include "fix.h"
+
+#include <Arduino.h>
+
+/* CONSTANTS */
+#define DECIMATION_MAX_FACTOR     16
+#define DECIMATION_TAPS_PER_PHASE 16
+#define DECIMATION_MAX_TAPS       (DECIMATION_MAX_FACTOR * DECIMATION_TAPS_PER_PHASE)
+#define DECIMATION_CUTOFF         0.8 // fraction of the output Nyquist frequency that is kept
+#define ADC_MIDSCALE              2048
+
+/* EXPORTED FUNCTIONS */
+void decimate_init(uint8_t factor);
+uint16_t decimate(const uint16_t *input, uint16_t in_len, uint16_t *output, uint16_t out_max, uint16_t *errors);
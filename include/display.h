@@ -1,5 +1,11 @@
 #pragma once
 #include "error.h"
+#include "framediff.h"
+#include "glyphs.h"
+#include "layer.h"
+#include "log.h"
+#include "profile.h"
+#include "ssd1306.h"
 
 #include <Arduino.h>
 #include <U8g2lib.h>
@@ -56,14 +62,37 @@ typedef struct display_tuner_t {
     bool soundback_en;
     display_note_t soundback_note;
     uint8_t soundback_octave;
+    uint32_t sequence; // pitch result on screen, for the latency trace
+    uint32_t captured;
 } tuner_t;
 
+typedef struct display_stats_t {
+    uint32_t frames;
+    uint32_t bytes;      // framebuffer bytes sent, all frames
+    uint32_t last_bytes; // sent by the newest frame
+    uint32_t total_us;   // render plus transfer, all frames
+    uint32_t last_us;
+    uint32_t max_us;
+    uint32_t render_us; // drawing alone, all frames
+    uint32_t last_render_us;
+} display_stats_t;
+
 /* CONSTANTS */
 #define DISPLAY_SDA     16
 #define DISPLAY_SCL     17
-#define DISPLAY_WIDTH   128
-#define DISPLAY_HEIGHT  64
 #define DISPLAY_ADDRESS 0x3C
+#define DISPLAY_REPORT  256 // frames between display_report() lines at DEBUG
+
+// Send frames from a DMA channel while the next one renders, instead of blocking in Wire.
+// The CPU gets the bus time back, but a frame ready mid-transfer waits for the one on the
+// bus; a newer frame replaces a waiting one rather than queueing behind it.
+#define DISPLAY_DMA
+
+// Start each screen from a cached copy of its static background instead of redrawing it
+#define DISPLAY_LAYERS
+
+// Copy note names and digits from glyphs cached at init instead of decoding the font each frame
+#define DISPLAY_GLYPHS
 
 // General tuner parameters
 #define INTUNE_TOLERANCE 2 // ± 2%
@@ -104,4 +133,7 @@ typedef struct display_tuner_t {
 void display_init();
 void display_tuner(struct display_tuner_t *tuner);
 void display_metronome(struct display_tuner_t *tuner);
-void display_soundback(struct display_tuner_t *tuner);
\ No newline at end of file
+void display_soundback(struct display_tuner_t *tuner);
+void display_invalidate();
+const display_stats_t *display_stats();
+void display_report();
@@ -9,7 +9,9 @@
 enum error_t { DEBUG, INFO, WARNING, ERROR };
 
 /* CONSTANTS */
+#ifndef MSG_LEVEL
 #define MSG_LEVEL DEBUG
+#endif
 
 /* EXPORTED FUNCTIONS */
 void error_init();
@@ -1,21 +1,117 @@
 #pragma once
+#include "arena.h"
+#include "capture.h"
 #include "error.h"
 #include "fix.h"
-#include "hardware/dma.h"
+#include "log.h"
 #include "pico/stdlib.h"
+#include "profile.h"
+#include "smooth.h"
+#include "stats.h"
 
 #include <Arduino.h>
 
 /* CONSTANTS */
 #define NUM_OCTAVES            8
-#define ROLLING_ITEMS          16
+#define ROLLING_ITEMS          16 // frames of history, up to STATS_MAX_WINDOW
 #define ROLLING_OUTLIER_THRESH 4 // number of entries before buffers swapped
 #define ROLLING_DEVIANCE_MULT  0.3
 #define LOW_NOISE_THRESH       30
+#define DECIMATION_FACTOR      4 // captured samples per FFT sample
+
+// Smooth on the median of the history rather than the mean, slower to follow but ignores spikes
+// #define ROLLING_MEDIAN
+
+// Split each radix-4 pass between the DSP core and the UI core for lower per-frame latency
+// #define FFT_PARALLEL_STAGES
+
+// Refine each raw estimate with a filter bank around its nearest note, ahead of the smoothing
+#define GOERTZEL_REFINE
+
+// Analyse the newest frame every this many decimated samples instead of back to back frames.
+// One capture's worth is 75% overlap at the default size, so 4 updates where there was 1,
+// but also 4 times the DSP work per capture. Off until the device shows it keeps up: with
+// it on, the "profile" dump's stage times and dropped captures say whether it does
+// #define FFT_SLIDING_HOP 1024
+
+static_assert(ROLLING_ITEMS <= STATS_MAX_WINDOW, "ROLLING_ITEMS is longer than a stats_t can hold");
+
+/* TYPES */
+enum fft_input_t {
+    FFT_INPUT_COMPLEX, // full N point complex FFT with a zeroed imaginary part
+    FFT_INPUT_REAL     // N real samples packed into an N/2 point complex FFT
+};
+
+enum fft_kernel_t {
+    FFT_KERNEL_RADIX2, // classic radix-2 butterflies, bit reversal computed per frame
+    FFT_KERNEL_RADIX4  // radix-4 butterflies, bit reversal from a table built in fft_init()
+};
+
+// Passes of the radix-4 FFT that can be split across both cores
+enum fft_pass_t { FFT_PASS_BITREVERSE, FFT_PASS_RADIX2, FFT_PASS_RADIX4 };
+
+typedef struct fft_job_t {
+    complex15 *data;
+    void (*run)(fft_pass_t pass, uint8_t part, uint8_t parts); // pass body for the current size
+    uint16_t fft_len;                                          // sub-FFT length going into the current pass
+    uint16_t fft_bits;                                         // twiddle stride for the current pass, as a shift
+} fft_job_t;
+
+/* PROFILING HOOKS */
+// Stages of do_fft(), each one a profile_probe_t of the same number
+enum fft_stage_t {
+    FFT_STAGE_DECIMATE,
+    FFT_STAGE_INGEST,
+    FFT_STAGE_BITREVERSE,
+    FFT_STAGE_BUTTERFLY,
+    FFT_STAGE_SPLIT,
+    FFT_STAGE_PEAK,
+    FFT_STAGE_INTERPOLATE,
+    FFT_STAGE_REFINE,
+    FFT_STAGE_AVERAGE,
+    FFT_STAGE_DONE
+};
+
+static_assert(FFT_STAGE_DONE == PROFILE_FFT_STAGES, "fft_stage_t and profile_probe_t are out of step");
+
+#ifdef PROFILE
+#define FFT_STAGE_MARK(stage) profile_stage(stage)
+#else
+#define FFT_STAGE_MARK(stage)
+#endif
+
+/* EXPORTED VARIABLES */
+extern fft_job_t fft_job;
 
 /* EXPORTED FUNTIONS */
-void fft_init(fix15 *fft_output, uint16_t num_bits, uint32_t samplerate);
+void fft_init(uint16_t num_bits, uint32_t samplerate);
+bool fft_set_size(uint8_t bits);
+uint8_t fft_size();
+void fft_run_pass(fft_pass_t pass);
 fix15 do_fft();
 void freq2note(fix15 freq, uint8_t *note_index, int8_t *cents_deviation);
+void freq2note_reference(fix15 freq, uint8_t *note_index, int8_t *cents_deviation);
 void change_fft_center(uint16_t new_center);
-uint32_t index2freq(uint8_t index);
\ No newline at end of file
+uint32_t index2freq(uint8_t index);
+fix15 note_frequency(uint8_t index);
+void fft_set_input_mode(fft_input_t mode);
+void fft_set_kernel(fft_kernel_t kernel);
+bool fft_set_format(uint8_t frac);
+void fft_set_window(fft_window_t window);
+void fft_set_smoothing(smooth_mode_t mode);
+void fft_set_parallel(bool enable);
+void fft_set_refine(bool enable);
+fix15 fft_refine(fix15 freq);
+void fft_parallel_helper_init();
+void fft_set_decimation(uint8_t factor);
+void fft_set_hop(uint16_t hop);
+void mic_dma_handler(uint16_t *data);
+void fft_set_capture_ring(capture_ring_t *ring);
+uint16_t *fft_next_frame(uint16_t *errors);
+uint16_t *fft_last_frame();
+uint32_t fft_frame_stamp();
+const fix15 *fft_window_table();
+uint32_t fft_frame_rate();
+uint16_t fft_frame_length();
+fix15 fft_smooth(fix15 freq);
+void fft_reset_smoothing();
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+#include "arena.h"
+#include "fft.h"
+#include "fix.h"
+#include "tables.h"
+
+#include <Arduino.h>
+
+/*
+ * The transform itself, specialised at compile time on the frame size and the fixed-point
+ * format. Lengths, strides and table shifts are all constants inside each instantiation, so
+ * the compiler can unroll and strength-reduce the butterfly loops. Every size is compiled in
+ * FFT_FRAC and FFT_ALT_FRAC, and fft.cpp picks one of the instantiations at runtime through
+ * fft_engine_ops().
+ */
+
+/* CONSTANTS */
+#define FFT_MIN_BITS 10 // shortest transform compiled in, sizes run FFT_MIN_BITS..FFT_MAX_BITS
+#define FFT_FRAC     15 // fractional bits the transform works in, unless fft_set_format() picks
+#define FFT_ALT_FRAC 12 // this one, three bits more headroom for three less precision
+
+/* TYPES */
+// One compiled size, as plain function pointers so it can be swapped between frames
+typedef struct fft_ops_t {
+    uint8_t bits;
+    uint8_t frac;
+    uint16_t (*ingest)(const uint16_t *frame, complex15 *x, fft_input_t mode);
+    void (*transform)(complex15 *x, fft_input_t mode, fft_kernel_t kernel);
+    uint16_t (*peak)(const complex15 *x, fix15 *max_val);
+} fft_ops_t;
+
+/**
+ * @brief FFT of 2^Bits real samples with Frac fractional bits in the working set
+ * @remarks Frac only sets how the spectrum is scaled internally, peak() always reports
+ *          fix15 so LOW_NOISE_THRESH means the same thing at every format.
+ */
+template <uint8_t Bits, uint8_t Frac = FFT_FRAC> class fft_engine {
+    static_assert(Bits >= FFT_MIN_BITS && Bits <= FFT_MAX_BITS, "FFT size is outside the compiled range");
+    // A windowed 12-bit sample plus two radix-4 additions has to stay inside an int32
+    static_assert(Frac >= 8 && Frac <= 15, "Not enough headroom for this fixed-point format");
+
+  public:
+    static constexpr uint16_t LENGTH = 1 << Bits;
+    static const fft_ops_t ops;
+
+    static uint16_t ingest(const uint16_t *frame, complex15 *x, fft_input_t mode);
+    static void transform(complex15 *x, fft_input_t mode, fft_kernel_t kernel);
+    static uint16_t peak(const complex15 *x, fix15 *max_val);
+
+  private:
+    // Twiddles index a 2^Bits point circle, the flash table is FFT_MAX_BITS deep
+    static constexpr uint8_t SINE_SHIFT = FFT_MAX_BITS - Bits;
+
+    template <uint8_t N> static void radix2(complex15 *x);
+    template <uint8_t N> static void radix4(complex15 *x);
+    template <uint8_t N> static void pass(fft_pass_t pass, uint8_t part, uint8_t parts);
+    static void real_split(complex15 *x);
+
+    static inline fix15 mul(fix15 a, fix15 b) {
+        return (fix15)(((int64_t)a * (int64_t)b) >> Frac);
+    }
+    static inline fix15 from_q15(fix15 v) {
+        return v >> (15 - Frac);
+    }
+    static inline fix15 twiddle_sin(uint32_t idx) {
+        return from_q15(table_sin(idx << SINE_SHIFT));
+    }
+    static inline fix15 twiddle_cos(uint32_t idx) {
+        return from_q15(table_cos(idx << SINE_SHIFT));
+    }
+};
+
+/* EXPORTED FUNCTIONS */
+const fft_ops_t *fft_engine_ops(uint8_t bits, uint8_t frac);
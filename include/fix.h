@@ -3,6 +3,10 @@
 
 /* FIX15 (Q16.15) Macros */
 typedef int32_t fix15;
+typedef struct complex15 {
+    fix15 re;
+    fix15 im;
+} complex15;
 #define multiply_fix15(a, b) ((fix15)((((int64_t)(a)) * ((int64_t)(b))) >> 15))
 #define divide_fix15(a, b)   ((fix15)(((int64_t)(a) << 15) / (b)))
 #define float2fix15(a)       ((fix15)((a)*32768.0)) // 2^15
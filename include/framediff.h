@@ -0,0 +1,32 @@
+#pragma once
+#include <Arduino.h>
+
+/*
+ * Keeps a copy of the last frame sent to the display and finds the 8x8 tiles that have
+ * changed since. The framebuffer is in the SSD1306 layout U8g2 uses: one byte is a column
+ * of 8 pixels, DISPLAY_WIDTH of them make a tile row, and a tile is 8 consecutive bytes.
+ */
+
+/* CONSTANTS */
+#define DISPLAY_WIDTH       128
+#define DISPLAY_HEIGHT      64
+#define DISPLAY_TILE_COLS   (DISPLAY_WIDTH / 8)
+#define DISPLAY_TILE_ROWS   (DISPLAY_HEIGHT / 8)
+#define DISPLAY_BUFFER_SIZE (DISPLAY_WIDTH * DISPLAY_HEIGHT / 8)
+#define FRAMEDIFF_GAP       1 // clean tiles sent anyway to join two runs, cheaper than addressing a new one
+
+/* TYPES */
+// Sends tiles tx..tx+tw-1 of tile row ty, which the diff has already copied into its last frame
+typedef void (*framediff_send_t)(uint8_t tx, uint8_t ty, uint8_t tw);
+
+typedef struct framediff_t {
+    uint8_t sent[DISPLAY_BUFFER_SIZE];   // what the display is showing
+    uint16_t flushed[DISPLAY_TILE_ROWS]; // tiles the last flush sent, a bit per tile column
+    uint16_t resend[DISPLAY_TILE_ROWS];  // tiles the next flush sends whether they changed or not
+    bool stale;                          // true until the first full frame goes out
+} framediff_t;
+
+/* EXPORTED FUNCTIONS */
+void framediff_invalidate(framediff_t *diff);
+void framediff_retract(framediff_t *diff);
+uint16_t framediff_flush(framediff_t *diff, const uint8_t *buffer, framediff_send_t send);
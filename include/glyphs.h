@@ -0,0 +1,46 @@
+#pragma once
+#include "error.h"
+#include "framediff.h"
+
+#include <Arduino.h>
+
+/*
+ * Cache of the few large glyphs the screens draw every frame: note names and digits.
+ * Each one is drawn once by U8g2, captured out of the framebuffer as a tight box of
+ * pixel columns, and from then on copied straight into the framebuffer a column at a
+ * time instead of decoding the compressed font again.
+ */
+
+/* CONSTANTS */
+#define GLYPH_CHARSET   "ABCDEFG#b0123456789" // everything in a note name or a number
+#define GLYPH_COUNT     (sizeof(GLYPH_CHARSET) - 1)
+#define GLYPH_MAX_WIDTH 32 // inr38 is 31 wide
+#define GLYPH_MAX_PAGES 6  // 48 pixels, inr38's capitals and digits are shorter
+
+/* TYPES */
+typedef struct glyph_t {
+    uint8_t bits[GLYPH_MAX_PAGES * GLYPH_MAX_WIDTH]; // w columns for each 8 rows of the box, top down
+    int8_t dx;                                       // box's top left, from the origin on the baseline
+    int8_t dy;
+    uint8_t w;
+    uint8_t h;
+    uint8_t advance; // origin to the next glyph's origin
+    uint8_t extent;  // origin to the glyph's right edge, where a string's width ends
+} glyph_t;
+
+typedef struct glyph_font_t {
+    glyph_t glyphs[GLYPH_COUNT];
+    uint8_t height; // ascent minus descent, which the screens lay text out by
+} glyph_font_t;
+
+/* EXPORTED FUNCTIONS */
+void glyph_capture(glyph_font_t *font,
+                   char c,
+                   const uint8_t *buffer,
+                   uint8_t x,
+                   uint8_t y,
+                   uint8_t advance,
+                   uint8_t extent);
+const glyph_t *glyph_find(const glyph_font_t *font, char c);
+uint8_t glyph_width(const glyph_font_t *font, const char *str);
+bool glyph_draw(uint8_t *buffer, const glyph_font_t *font, int16_t x, int16_t y, const char *str);
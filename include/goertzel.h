@@ -0,0 +1,14 @@
+#pragma once
+#include "decimate.h"
+#include "error.h"
+#include "fft.h"
+#include "fix.h"
+
+#include <Arduino.h>
+
+/* CONSTANTS */
+#define GOERTZEL_BINS    9    // filters in the bank, odd so one sits on the note
+#define GOERTZEL_SPACING 12.5 // cents between neighbouring filters
+
+/* EXPORTED FUNCTIONS */
+fix15 goertzel_refine(fix15 freq, uint8_t note_index);
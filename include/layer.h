@@ -0,0 +1,23 @@
+#pragma once
+#include "framediff.h"
+
+#include <Arduino.h>
+
+/*
+ * A screen's static background, drawn once into the framebuffer and kept as a copy.
+ * Each frame starts from the copy instead of a cleared buffer, so only what moves has
+ * to be drawn again. The key says which variant of the background is cached, e.g. the
+ * tuner's music or money glyph; a different key means drawing it again.
+ */
+
+/* TYPES */
+typedef struct layer_t {
+    uint8_t bitmap[DISPLAY_BUFFER_SIZE]; // same layout as the framebuffer
+    uint16_t key;
+    bool cached;
+} layer_t;
+
+/* EXPORTED FUNCTIONS */
+void layer_invalidate(layer_t *layer);
+bool layer_restore(const layer_t *layer, uint8_t *buffer, uint16_t key);
+void layer_save(layer_t *layer, const uint8_t *buffer, uint16_t key);
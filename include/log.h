@@ -0,0 +1,94 @@
+#pragma once
+#include "error.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+
+#include <Arduino.h>
+#include <type_traits>
+
+/*
+ * Deferred logging. LOG_DEBUG() and friends below MSG_LEVEL compile away, arguments
+ * and all. The rest copy the format string's address, a timestamp and their raw
+ * arguments into a ring for the core they run on, with no formatting, so they're safe
+ * in IRQs and cheap in the DSP loop. log_drain(), from core0's idle time, empties the
+ * rings to Serial as binary records that tools/logdecode.py expands against the
+ * firmware ELF, or as text with LOG_TEXT.
+ */
+
+/* CONSTANTS */
+#define LOG_RING_SIZE 64 // records per core, a power of 2
+#define LOG_MAX_ARGS  6
+#define LOG_CORES     2
+#define LOG_SYNC_0    0xF5 // binary records start with these, neither is ever printed as text
+#define LOG_SYNC_1    0x1A
+
+// Format each record in the drain instead of sending it, for a plain serial monitor
+#ifdef NATIVE_BUILD
+#define LOG_TEXT
+#endif
+
+/* TYPES */
+typedef struct log_record_t {
+    const char *format; // in flash, so its address is the message ID
+    uint32_t time_us;
+    uint8_t level;
+    uint8_t core;
+    uint8_t count;
+    uintptr_t args[LOG_MAX_ARGS]; // integers as is, floats as their float bits, strings as pointers
+} log_record_t;
+
+// Filled by one core, its IRQs included, and emptied by log_drain()
+typedef struct log_ring_t {
+    log_record_t records[LOG_RING_SIZE];
+    volatile bool ready[LOG_RING_SIZE]; // set once a reserved record is filled in
+    volatile uint32_t head;             // next record to reserve
+    volatile uint32_t tail;             // next record to drain
+    volatile uint32_t dropped;          // records lost to a full ring, ever
+} log_ring_t;
+
+/* MACROS */
+#define LOG_AT(level, ...)                                                \
+    do {                                                                  \
+        if constexpr ((level) >= MSG_LEVEL) log_push(level, __VA_ARGS__); \
+    } while (0)
+#define LOG_DEBUG(...)   LOG_AT(DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)    LOG_AT(INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(WARNING, __VA_ARGS__)
+#define LOG_ERROR(...)   LOG_AT(ERROR, __VA_ARGS__)
+
+/* EXPORTED FUNCTIONS */
+void log_write(error_t level, const char *format, const uintptr_t *args, uint8_t count);
+bool log_pop(uint8_t core, log_record_t *record);
+uint16_t log_drain();
+void log_format(char *output, size_t size, const log_record_t *record);
+uint32_t log_dropped(uint8_t core);
+
+/**
+ * @brief Packs one printf argument into a log word
+ * @note 64-bit integers keep their low 32 bits
+ */
+template <typename T> inline uintptr_t log_word(T x) {
+    if constexpr (std::is_floating_point<T>::value) {
+        float f = (float)x;
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    } else if constexpr (std::is_pointer<T>::value) {
+        return (uintptr_t)x;
+    } else {
+        return (uintptr_t)(uint32_t)x;
+    }
+}
+
+/**
+ * @brief Queues a message for log_drain(), use the LOG_ macros instead
+ *
+ * @param level severity
+ * @param format printf format, must be a string literal
+ * @param args up to LOG_MAX_ARGS integers, floats or string literals
+ */
+template <typename... T> inline void log_push(error_t level, const char *format, T... args) {
+    static_assert(sizeof...(T) <= LOG_MAX_ARGS, "Too many log arguments");
+    const uintptr_t words[] = {log_word(args)..., 0};
+    log_write(level, format, words, sizeof...(T));
+}
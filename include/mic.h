@@ -1,16 +1,19 @@
 #pragma once
+#include "capture.h"
 #include "error.h"
 #include "hardware/adc.h"
 #include "hardware/dma.h"
 #include "hardware/gpio.h"
+#include "log.h"
 #include "pico/stdlib.h"
+#include "profile.h"
 
 #include <Arduino.h>
 
 /* CONSTANTS */
 #define MIC_ADC_PIN     26
 #define CAPTURE_BITS    12
-#define CAPTURE_DEPTH   1 << CAPTURE_BITS
+#define CAPTURE_DEPTH   (1 << CAPTURE_BITS)
 #define MIC_SAMPLE_RATE 96000 * 2
 
 static_assert(CAPTURE_BITS < 16, "CAPTURE_DEPTH must be less than 16 bits long");
@@ -19,5 +22,5 @@ static_assert(CAPTURE_BITS < 16, "CAPTURE_DEPTH must be less than 16 bits long")
 #define ADC2VOLTAGE(a) ((a)*3.3f / (1 << 12))
 
 /* EXPORTED FUNCTIONS */
-void mic_init(uint16_t *front_buf, uint16_t *back_buf);
-void mic_dma_handler(uint16_t *data);
+void mic_init(uint16_t *buffers[], uint8_t count);
+capture_ring_t *mic_capture_ring();
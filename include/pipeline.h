@@ -0,0 +1,37 @@
+#pragma once
+#include "error.h"
+#include "fft.h"
+#include "fix.h"
+#include "yin.h"
+
+#include <Arduino.h>
+
+/* TYPES */
+enum pitch_engine_t { ENGINE_FFT, ENGINE_YIN };
+
+typedef struct pitch_result_t {
+    uint32_t sequence;  // incremented for every published result, gaps mean drops
+    uint32_t timestamp; // micros() when the estimate was finished
+    uint32_t captured;  // profile_now() when its newest samples came off the DMA
+    fix15 frequency;    // Hz, or int2fix15(-1) for a low noise frame
+    uint8_t note_index; // half-steps above C0
+    int8_t cents_deviation;
+} pitch_result_t;
+
+/* CONSTANTS */
+#define PIPELINE_QUEUE_DEPTH 8 // results buffered between the cores, power of 2
+
+static_assert((PIPELINE_QUEUE_DEPTH & (PIPELINE_QUEUE_DEPTH - 1)) == 0, "PIPELINE_QUEUE_DEPTH must be a power of 2");
+
+/* EXPORTED FUNCTIONS */
+// Producer side, runs on core1
+void pipeline_init();
+bool pipeline_step();
+
+// Consumer side, runs on core0
+bool pipeline_pop(pitch_result_t *result);
+void pipeline_set_engine(pitch_engine_t engine);
+void pipeline_set_center(uint16_t center);
+void pipeline_set_fft_size(uint8_t bits);
+pitch_engine_t pipeline_engine();
+uint32_t pipeline_dropped();
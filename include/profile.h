@@ -0,0 +1,113 @@
+#pragma once
+#include "capture.h"
+#include "error.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+
+#include <Arduino.h>
+
+/*
+ * Probes on the hot path: each do_fft() stage, freq2note(), each display_*() render and
+ * the flush to the panel. Every span goes into a fixed table of count, min, max, sum and
+ * a log-linear histogram per probe, so the device can say where frame time goes under
+ * real input. Type "profile" into the serial monitor for the table, "profile reset" to
+ * start over. Ticks are microseconds on the device and nanoseconds on the host.
+ *
+ * One more row traces whole tuner frames: stamped when the mic DMA finishes a buffer,
+ * carried through the pitch engine and the pipeline, and closed once the frame showing
+ * the result is all on the panel. Results that never make it there count as dropped.
+ * The dump ends with the mic capture ring's counters, see profile_watch_captures().
+ */
+
+/* CONSTANTS */
+// Compile the probes in, comment out to leave nothing of them
+#define PROFILE
+
+#define PROFILE_SUB_BITS   2 // histogram buckets per power of 2, as a shift: 4 keeps every bucket within 25%
+#define PROFILE_BUCKETS    96 // up to 2^25 ticks, longer spans share the last bucket
+#define PROFILE_FFT_STAGES 9 // probes fed by FFT_STAGE_MARK(), in fft_stage_t order
+#define PROFILE_COMMAND    24 // longest serial command
+
+#ifdef NATIVE_BUILD
+#define PROFILE_TICKS_PER_US 1000
+#else
+#define PROFILE_TICKS_PER_US 1
+#endif
+
+/* TYPES */
+enum profile_probe_t {
+    PROFILE_DECIMATE,
+    PROFILE_INGEST,
+    PROFILE_BITREVERSE,
+    PROFILE_BUTTERFLY,
+    PROFILE_SPLIT,
+    PROFILE_PEAK,
+    PROFILE_INTERPOLATE,
+    PROFILE_REFINE,
+    PROFILE_AVERAGE,
+    PROFILE_FREQ2NOTE,
+    PROFILE_DISPLAY_TUNER,
+    PROFILE_DISPLAY_METRONOME,
+    PROFILE_DISPLAY_SOUNDBACK,
+    PROFILE_FLUSH,   // sending the changed tiles, or queueing them with DISPLAY_DMA
+    PROFILE_LATENCY, // mic DMA finishing a buffer to the result being on the panel
+    PROFILE_PROBES
+};
+
+// One probe's spans, only ever written from the core the probe runs on
+typedef struct profile_stats_t {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[PROFILE_BUCKETS];
+    uint32_t epoch; // profile_reset() calls this has seen
+} profile_stats_t;
+
+// Tuner frames that reached the panel and pitch results that didn't
+typedef struct profile_frames_t {
+    uint32_t shown;
+    uint32_t dropped;
+    uint32_t next_sequence; // expected from the next frame shown
+    bool resync;            // don't count the gap before the next frame as drops
+    uint32_t epoch;
+} profile_frames_t;
+
+/* MACROS */
+#ifdef PROFILE
+#define PROFILE_START(start)       uint32_t start = profile_now()
+#define PROFILE_STOP(probe, start) profile_record(probe, profile_now() - (start))
+#else
+#define PROFILE_START(start)
+#define PROFILE_STOP(probe, start)
+#endif
+
+/* EXPORTED FUNCTIONS */
+void profile_record(profile_probe_t probe, uint32_t ticks);
+void profile_stage(uint8_t stage);
+void profile_reset();
+const profile_stats_t *profile_get(profile_probe_t probe);
+const char *profile_name(profile_probe_t probe);
+void profile_shown(uint32_t sequence, uint32_t captured);
+void profile_resync();
+const profile_frames_t *profile_frames();
+void profile_watch_captures(const capture_ring_t *ring);
+uint32_t profile_mean(const profile_stats_t *stats);
+uint32_t profile_percentile(const profile_stats_t *stats, uint8_t percent);
+void profile_dump();
+void profile_poll();
+
+/**
+ * @brief Reads the profiling clock
+ *
+ * @return uint32_t ticks, wrapping
+ */
+inline uint32_t profile_now() {
+#ifdef NATIVE_BUILD
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#else
+    return time_us_32();
+#endif
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "fix.h"
+#include "tables.h"
+
+#include <Arduino.h>
+
+/*
+ * Adaptive pitch smoothers. Both work on log-frequency in cents, so a jump of a semitone
+ * looks the same at 80Hz as it does at 800Hz. Neither smooths across a new note: a frame
+ * far enough off is held back until the next ones agree with it, then the filter restarts
+ * there. That keeps the FFT's odd harmonic picked as the fundamental out, at the cost of
+ * ONE_EURO_CONFIRM frames on a new note for One-Euro, and KALMAN_CONFIRM, or
+ * KALMAN_OCTAVE_CONFIRM on a jump of an octave, for Kalman.
+ */
+
+/* CONSTANTS */
+#define ONE_EURO_MIN_CUTOFF   1.0   // Hz, how hard a held note is smoothed
+#define ONE_EURO_BETA         0.002 // Hz of cutoff added per cent/s the pitch is moving
+#define ONE_EURO_D_CUTOFF     1.0   // Hz, smoothing on the speed estimate itself
+#define ONE_EURO_SNAP_CENTS   50.0  // a frame this far off is a new note or an outlier, not smoothed towards
+#define ONE_EURO_CONFIRM      2     // frames in a row past the snap, and agreeing, that make a new note
+#define KALMAN_DRIFT_CENTS    2.0   // how far a held note is expected to wander between frames
+#define KALMAN_NOISE_CENTS    25.0  // scatter of a single frame's estimate, about what 12-bit frames show
+#define KALMAN_GATE           3     // sigmas off the estimate before a frame is a new note or an outlier
+#define KALMAN_CONFIRM        1     // frames in a row off the gate, and agreeing, that make a new note
+#define KALMAN_OCTAVE_CONFIRM 2     // the same, for a jump of an octave, which is usually the FFT picking a harmonic
+
+/* TYPES */
+enum smooth_mode_t {
+    SMOOTH_OFF,      // raw estimates, for comparison
+    SMOOTH_ROLLING,  // rolling mean with outlier shelving, see fft_smooth()
+    SMOOTH_ONE_EURO, // low-pass whose cutoff rises with the speed of the pitch
+    SMOOTH_KALMAN,   // random walk Kalman filter, a note change is KALMAN_CONFIRM frames agreeing off the gate
+    SMOOTH_COUNT
+};
+
+// One-Euro filter, Casiez et al. 2012
+typedef struct one_euro_t {
+    int64_t cents; // filtered pitch, Q16
+    int64_t speed;   // filtered cents per second, Q16
+    int64_t pending; // sum of the frames held back past the snap, Q16
+    uint8_t held;    // how many there are, all in a row and agreeing
+    bool primed;
+} one_euro_t;
+
+// 1-D Kalman filter on a pitch modelled as a random walk
+typedef struct kalman_t {
+    int64_t cents;   // estimate, Q16
+    int64_t var;     // its variance in cents^2, Q16
+    int64_t pending; // sum of the frames held back outside the gate, Q16
+    uint8_t held;    // how many there are, all in a row and agreeing
+    bool primed;
+} kalman_t;
+
+/* EXPORTED FUNCTIONS */
+void one_euro_reset(one_euro_t *filter);
+fix15 one_euro_update(one_euro_t *filter, fix15 freq, uint32_t rate);
+void kalman_reset(kalman_t *filter);
+fix15 kalman_update(kalman_t *filter, fix15 freq);
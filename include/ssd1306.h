@@ -0,0 +1,54 @@
+#pragma once
+#include "error.h"
+#include "framediff.h"
+#include "hardware/dma.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "log.h"
+#include "profile.h"
+
+#include <Arduino.h>
+
+/*
+ * Non-blocking SSD1306 transport. Tile runs are encoded straight into an I2C command
+ * stream, which a DMA channel feeds to the I2C peripheral while the CPU gets on with the
+ * next frame. There are two streams: one on the bus and one being built or waiting its
+ * turn, so they double as the second framebuffer. A frame started while one is still
+ * waiting takes its stream over, so the panel only ever lags by the transfer in flight.
+ */
+
+/* CONSTANTS */
+#define SSD1306_RUN_WORDS    5 // control byte and page/column commands, then the data control byte
+#define SSD1306_STREAM_WORDS (DISPLAY_TILE_ROWS * SSD1306_RUN_WORDS + DISPLAY_BUFFER_SIZE) // a full frame
+#define SSD1306_STREAMS      2
+#define SSD1306_TIMEOUT_US   100000 // a stream taking longer than this means the bus is stuck
+
+/* TYPES */
+typedef struct ssd1306_stream_t {
+    uint16_t words[SSD1306_STREAM_WORDS]; // IC_DATA_CMD values, STOP flagged on the last of each transfer
+    uint16_t length;
+    bool traced;       // report the frame to profile_shown() once it's on the bus
+    uint32_t sequence; // see ssd1306_trace()
+    uint32_t captured;
+} ssd1306_stream_t;
+
+typedef struct ssd1306_stats_t {
+    uint32_t streams;  // handed to the DMA
+    uint32_t words;    // bytes put on the bus, addressing included
+    uint32_t waits;    // frames that had to wait for a free stream
+    uint32_t wait_us;  // and how long, in total
+    uint32_t replaced; // queued streams taken back by a newer frame before they started
+    uint32_t timeouts; // streams abandoned after SSD1306_TIMEOUT_US
+} ssd1306_stats_t;
+
+/* EXPORTED FUNCTIONS */
+void ssd1306_init(i2c_inst_t *i2c, uint8_t address);
+bool ssd1306_begin();
+void ssd1306_tiles(const uint8_t *frame, uint8_t tx, uint8_t ty, uint8_t tw);
+void ssd1306_trace(uint32_t sequence, uint32_t captured);
+void ssd1306_commit();
+bool ssd1306_busy();
+void ssd1306_wait();
+bool ssd1306_lost();
+const ssd1306_stats_t *ssd1306_stats();
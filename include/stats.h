@@ -0,0 +1,37 @@
+#pragma once
+#include "error.h"
+#include "fix.h"
+
+#include <Arduino.h>
+
+/* CONSTANTS */
+#define STATS_MAX_WINDOW 64 // longest history a stats_t can hold
+#define STATS_MEAN_BITS  4  // extra fractional bits the Welford mean carries over fix15
+
+/* TYPES */
+// Sliding window over the newest `window` samples, every statistic updated as samples arrive
+typedef struct stats_t {
+    fix15 values[STATS_MAX_WINDOW]; // ring of samples, oldest at `next` once full
+    uint8_t window;
+    uint8_t count;
+    uint8_t next;
+
+    int64_t sum;    // exact, so the mean never drifts
+    int64_t mean_q; // sum / count with STATS_MEAN_BITS extra fractional bits
+    int64_t m2;     // Welford sum of squared deviations, fix15 units
+
+    // Median as a max-heap of the lower half and a min-heap of the upper half, holding ring slots
+    uint8_t heap[2][STATS_MAX_WINDOW];
+    uint8_t heap_size[2];
+    uint8_t slot_heap[STATS_MAX_WINDOW]; // which heap each ring slot is in
+    uint8_t slot_pos[STATS_MAX_WINDOW];  // and where
+} stats_t;
+
+/* EXPORTED FUNCTIONS */
+void stats_init(stats_t *stats, uint8_t window);
+void stats_reset(stats_t *stats);
+void stats_push(stats_t *stats, fix15 x);
+uint8_t stats_count(const stats_t *stats);
+fix15 stats_mean(const stats_t *stats);
+fix15 stats_variance(const stats_t *stats);
+fix15 stats_median(const stats_t *stats);
@@ -0,0 +1,286 @@
+#pragma once
+#include "fix.h"
+
+#include <Arduino.h>
+
+/*
+ * Lookup tables generated by the compiler. Everything here is constexpr, so the tables
+ * land in flash and the RP2040 never runs sin(), pow() or sqrt() to build them at boot.
+ */
+
+/* CONSTANTS */
+#ifndef FFT_MAX_BITS
+#define FFT_MAX_BITS 12 // deepest fft_init() the tables and the DSP arena have room for
+#endif
+#define FFT_MAX_DEPTH     (1 << FFT_MAX_BITS)
+#define KAISER_BETA       8.6 // Kaiser window shape, higher trades main lobe width for sidelobes
+#define NOTE_TABLE_LENGTH 96  // C0 through B7
+#define NOTE_A4_INDEX     57  // half-steps from C0 up to A4
+#define LOG2_SEGMENT_BITS 7   // log2() table resolution, 2^7 segments across each octave
+#define LOG2_SEGMENTS     (1 << LOG2_SEGMENT_BITS)
+#define LOG2_E_Q30        1549082005LL // 1 / ln(2) in Q30
+#define LN2_Q30           744261118LL  // ln(2) in Q30
+
+/* TYPES */
+enum fft_window_t {
+    FFT_WINDOW_HANN,            // -31dB sidelobes, narrowest main lobe of the four
+    FFT_WINDOW_BLACKMAN_HARRIS, // -92dB sidelobes, for quiet partials next to loud ones
+    FFT_WINDOW_FLAT_TOP,        // widest main lobe but almost no scalloping loss
+    FFT_WINDOW_KAISER,          // tunable with KAISER_BETA
+    FFT_WINDOW_COUNT
+};
+
+/* COMPILE-TIME MATH */
+constexpr double __ce_pi = 3.14159265358979323846;
+
+/**
+ * @brief sin() the compiler can evaluate, Taylor series after folding into [-pi/2, pi/2]
+ */
+constexpr double __ce_sin(double x) {
+    while (x > __ce_pi) x -= 2 * __ce_pi;
+    while (x < -__ce_pi) x += 2 * __ce_pi;
+    if (x > __ce_pi / 2) x = __ce_pi - x;
+    if (x < -__ce_pi / 2) x = -__ce_pi - x;
+
+    double term = x, sum = x;
+    for (int n = 1; n < 12; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double __ce_cos(double x) {
+    return __ce_sin(x + __ce_pi / 2);
+}
+
+/**
+ * @brief sqrt() the compiler can evaluate, Newton's method
+ */
+constexpr double __ce_sqrt(double x) {
+    if (x <= 0) return 0;
+    double guess = x < 1 ? 1 : x;
+    for (int n = 0; n < 24; n++) guess = (guess + x / guess) / 2;
+    return guess;
+}
+
+/**
+ * @brief Natural log the compiler can evaluate, 2 atanh((x - 1) / (x + 1)) for x in [1, 2]
+ */
+constexpr double __ce_log(double x) {
+    double z = (x - 1) / (x + 1), z2 = z * z, term = z, sum = 0;
+    for (int k = 0; k < 24; k++) {
+        sum += term / (2 * k + 1);
+        term *= z2;
+    }
+    return 2 * sum;
+}
+
+/**
+ * @brief e^x the compiler can evaluate, Taylor series for small x
+ */
+constexpr double __ce_exp(double x) {
+    double term = 1, sum = 1;
+    for (int k = 1; k < 24; k++) {
+        term *= x / k;
+        sum += term;
+    }
+    return sum;
+}
+
+/**
+ * @brief Zeroth order modified Bessel function of the first kind, for the Kaiser window
+ */
+constexpr double __ce_bessel_i0(double x) {
+    double sum = 1, term = 1;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/**
+ * @brief Unscaled window value at sample i of an n sample frame
+ */
+constexpr double __ce_window(fft_window_t window, uint32_t i, uint32_t n) {
+    double phase = 2 * __ce_pi * i / n;
+    if (window == FFT_WINDOW_HANN) {
+        return 0.5 - 0.5 * __ce_cos(phase);
+    } else if (window == FFT_WINDOW_BLACKMAN_HARRIS) {
+        return 0.35875 - 0.48829 * __ce_cos(phase) + 0.14128 * __ce_cos(2 * phase) - 0.01168 * __ce_cos(3 * phase);
+    } else if (window == FFT_WINDOW_FLAT_TOP) {
+        return 0.21557895 - 0.41663158 * __ce_cos(phase) + 0.277263158 * __ce_cos(2 * phase) -
+               0.083578947 * __ce_cos(3 * phase) + 0.006947368 * __ce_cos(4 * phase);
+    }
+    double ratio = 2.0 * i / n - 1;
+    return __ce_bessel_i0(KAISER_BETA * __ce_sqrt(1 - ratio * ratio)) / __ce_bessel_i0(KAISER_BETA);
+}
+
+/* TABLES */
+/**
+ * @brief First quarter of sin(2 * pi * i / 2^Bits), inclusive of the peak
+ * @note The other three quarters are mirror images, see table_sin()
+ */
+template <uint8_t Bits> struct quarter_sine_table {
+    fix15 values[(1 << Bits) / 4 + 1];
+
+    constexpr quarter_sine_table() : values() {
+        for (uint32_t i = 0; i <= (1 << Bits) / 4; i++) {
+            values[i] = float2fix15(__ce_sin(2 * __ce_pi * i / (1 << Bits)));
+        }
+    }
+};
+
+/**
+ * @brief First half of every window at 2^Bits points, inclusive of the centre
+ * @remarks Each window is scaled to Hann's mean so peak heights compare across windows.
+ *          All four are symmetric and sampled on the same grid as the FFT, so shorter
+ *          frames read them with a stride.
+ */
+template <uint8_t Bits> struct window_tables {
+    fix15 values[FFT_WINDOW_COUNT][(1 << Bits) / 2 + 1];
+
+    constexpr window_tables() : values() {
+        const uint32_t half = (1 << Bits) / 2;
+        for (uint8_t w = 0; w < FFT_WINDOW_COUNT; w++) {
+            // w[i] == w[N - i], so the sum over the full frame only needs the first half
+            double shape[half + 1] = {};
+            double sum             = 0;
+            for (uint32_t i = 0; i <= half; i++) {
+                shape[i] = __ce_window((fft_window_t)w, i, 1 << Bits);
+                sum += (i == 0 || i == half) ? shape[i] : 2 * shape[i];
+            }
+
+            double scale = half / sum;
+            for (uint32_t i = 0; i <= half; i++) values[w][i] = float2fix15(shape[i] * scale);
+        }
+    }
+};
+
+/**
+ * @brief Frequency ratio to A4 of each note from C0 to B7, 2^((i - 57) / 12)
+ */
+struct note_ratio_table {
+    double values[NOTE_TABLE_LENGTH];
+
+    constexpr note_ratio_table() : values() {
+        // Twelfth root of two by Newton's method, then stepped out from A4 both ways
+        double semitone = 1.06;
+        for (int n = 0; n < 16; n++) {
+            double power = 1;
+            for (int k = 0; k < 11; k++) power *= semitone;
+            semitone -= (power * semitone - 2) / (12 * power);
+        }
+
+        values[NOTE_A4_INDEX] = 1;
+        for (int i = NOTE_A4_INDEX + 1; i < NOTE_TABLE_LENGTH; i++) values[i] = values[i - 1] * semitone;
+        for (int i = NOTE_A4_INDEX - 1; i >= 0; i--) values[i] = values[i + 1] / semitone;
+    }
+};
+
+/**
+ * @brief log2(1 + k / LOG2_SEGMENTS) and its reciprocal argument, both in Q30
+ * @remarks The reciprocal turns the offset into a segment into a ratio, so a short
+ *          log(1 + v) series can finish the job without a division.
+ */
+struct log2_table {
+    uint32_t values[LOG2_SEGMENTS + 1];
+    uint32_t inverse[LOG2_SEGMENTS];
+
+    constexpr log2_table() : values(), inverse() {
+        const double ln2 = __ce_log(2);
+        for (uint32_t k = 0; k <= LOG2_SEGMENTS; k++) {
+            double a  = 1 + (double)k / LOG2_SEGMENTS;
+            values[k] = (uint32_t)(__ce_log(a) / ln2 * (1 << 30) + 0.5);
+            if (k < LOG2_SEGMENTS) inverse[k] = (uint32_t)(1 / a * (1 << 30) + 0.5);
+        }
+    }
+};
+
+/**
+ * @brief 2^(k / LOG2_SEGMENTS) in Q30, the inverse of log2_table
+ */
+struct exp2_table {
+    uint32_t values[LOG2_SEGMENTS];
+
+    constexpr exp2_table() : values() {
+        const double ln2 = __ce_log(2);
+        for (uint32_t k = 0; k < LOG2_SEGMENTS; k++) {
+            values[k] = (uint32_t)(__ce_exp(ln2 * k / LOG2_SEGMENTS) * (1 << 30) + 0.5);
+        }
+    }
+};
+
+/* EXPORTED TABLES */
+extern const quarter_sine_table<FFT_MAX_BITS> QUARTER_SINE;
+extern const window_tables<FFT_MAX_BITS> WINDOW_TABLES;
+extern const note_ratio_table NOTE_RATIOS;
+extern const log2_table LOG2_TABLE;
+extern const exp2_table EXP2_TABLE;
+
+/**
+ * @brief sin(2 * pi * phase / FFT_MAX_DEPTH) from the quarter-wave table
+ *
+ * @param phase angle in FFT_MAX_DEPTH steps per turn, wraps
+ * @return fix15 sine
+ */
+static inline fix15 table_sin(uint32_t phase) {
+    const uint32_t quarter = FFT_MAX_DEPTH / 4;
+    uint32_t index         = phase & (quarter - 1);
+    switch ((phase / quarter) & 3) {
+        case 0: return QUARTER_SINE.values[index];
+        case 1: return QUARTER_SINE.values[quarter - index];
+        case 2: return -QUARTER_SINE.values[index];
+        default: return -QUARTER_SINE.values[quarter - index];
+    }
+}
+
+/**
+ * @brief cos(2 * pi * phase / FFT_MAX_DEPTH) from the quarter-wave table
+ *
+ * @param phase angle in FFT_MAX_DEPTH steps per turn, wraps
+ * @return fix15 cosine
+ */
+static inline fix15 table_cos(uint32_t phase) {
+    return table_sin(phase + FFT_MAX_DEPTH / 4);
+}
+
+/**
+ * @brief log2(x) in Q30 from CLZ, a segment table and a cubic
+ * @remarks x = 2^e * a * (1 + v), where a starts one of LOG2_SEGMENTS segments and v < 2^-7.
+ *          log(1 + v) to the cubic term is then good to about 1e-9 of an octave.
+ *
+ * @param x positive integer
+ * @return int64_t log2(x) in Q30
+ */
+static inline int64_t table_log2(uint32_t x) {
+    uint8_t e  = 31 - __builtin_clz(x);
+    uint32_t m = e <= 30 ? x << (30 - e) : x >> 1; // mantissa in [1, 2) as Q30
+
+    uint32_t k = (m >> (30 - LOG2_SEGMENT_BITS)) & (LOG2_SEGMENTS - 1);
+    int64_t d  = m - ((LOG2_SEGMENTS + k) << (30 - LOG2_SEGMENT_BITS));
+    int64_t v  = (d * LOG2_TABLE.inverse[k]) >> 30;
+    int64_t v2 = (v * v) >> 30;
+    int64_t v3 = (v2 * v) >> 30;
+    int64_t ln = v - v2 / 2 + v3 / 3;
+
+    return ((int64_t)e << 30) + LOG2_TABLE.values[k] + ((ln * LOG2_E_Q30) >> 30);
+}
+
+/**
+ * @brief 2^y from a segment table and a quadratic, the inverse of table_log2()
+ * @remarks y = e + k / LOG2_SEGMENTS + r with r < 2^-7, and e^(r ln 2) to the square term
+ *          leaves about 3e-8 of relative error.
+ *
+ * @param y exponent in Q30, 0 up to but not including 32
+ * @return uint32_t 2^y rounded to an integer
+ */
+static inline uint32_t table_exp2(int64_t y) {
+    uint8_t e  = y >> 30;
+    uint32_t k = (y >> (30 - LOG2_SEGMENT_BITS)) & (LOG2_SEGMENTS - 1);
+    int64_t t  = ((y & ((1 << (30 - LOG2_SEGMENT_BITS)) - 1)) * LN2_Q30) >> 30;
+    int64_t m  = EXP2_TABLE.values[k] + ((EXP2_TABLE.values[k] * (t + ((t * t) >> 31))) >> 30);
+
+    return e >= 30 ? (uint32_t)(m << (e - 30)) : (uint32_t)((m + (1LL << (29 - e))) >> (30 - e));
+}
@@ -3,14 +3,24 @@
 #include "display.h"
 #include "error.h"
 #include "fft.h"
+#include "fft_engine.h"
 #include "fix.h"
+#include "log.h"
 #include "mic.h"
+#include "pipeline.h"
 
 #include <Arduino.h>
 
 /* Types */
 enum tuner_mode_t { MODE_TUNER, MODE_TUNER_MEME, MODE_SOUNDBACK, MODE_METRONOME };
 
+// What the encoder button steps through in tuner mode
+typedef struct tuner_preset_t {
+    pitch_engine_t engine;
+    uint8_t fft_bits; // frame size, FFT_MIN_BITS to FFT_MAX_BITS
+    const char *name;
+} tuner_preset_t;
+
 /* CONSTANTS */
 #define PIZEO_PIN           15
 #define METRONOME_LOW_TONE  880
@@ -0,0 +1,15 @@
+#pragma once
+#include "error.h"
+#include "fft.h"
+#include "fix.h"
+
+#include <Arduino.h>
+
+/* CONSTANTS */
+#define YIN_WINDOW    1024 // samples integrated per lag
+#define YIN_MIN_FREQ  40   // lowest detectable pitch, sets the longest lag
+#define YIN_MAX_FREQ  2000 // highest detectable pitch, sets the shortest lag
+#define YIN_THRESHOLD 0.15 // normalized difference below which a lag counts as periodic
+
+/* EXPORTED FUNCTIONS */
+fix15 do_yin();
@@ -0,0 +1,67 @@
+#pragma once
+/*
+ * Host stand-in for the Arduino core. Only what the DSP code and the benchmark
+ * need is provided; anything touching real hardware is a no-op.
+ */
+// glibc's errno.h declares an error_t typedef which collides with the enum in error.h,
+// so pull in every system header under a different name before the project sees it
+#define error_t glibc_error_t
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/types.h>
+#include <thread>
+#undef error_t
+
+#define LED_BUILTIN 25
+#define OUTPUT      1
+#define INPUT       0
+#define HIGH        1
+#define LOW         0
+
+// The core's abs() handles floating point, unlike the int-only one from stdlib.h
+using std::abs;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline void pinMode(int pin, int mode) {}
+inline void digitalWrite(int pin, int val) {}
+inline int digitalRead(int pin) { return 0; }
+
+inline unsigned long micros() {
+    using namespace std::chrono;
+    return (unsigned long)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+inline unsigned long millis() { return micros() / 1000; }
+
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+// Serial output goes to stderr so stdout stays free for benchmark results
+class HostSerial {
+  public:
+    void begin(unsigned long baud) {}
+    int available() { return 0; }
+    int read() { return -1; }
+
+    void print(const char *s) { fputs(s, stderr); }
+    void print(char c) { fputc(c, stderr); }
+    void print(int v) { fprintf(stderr, "%d", v); }
+    void print(unsigned int v) { fprintf(stderr, "%u", v); }
+    void print(long v) { fprintf(stderr, "%ld", v); }
+    void print(unsigned long v) { fprintf(stderr, "%lu", v); }
+    void print(double v) { fprintf(stderr, "%.2f", v); }
+    size_t write(const uint8_t *buffer, size_t size) { return fwrite(buffer, 1, size, stderr); }
+
+    template <typename T> void println(T v) {
+        print(v);
+        println();
+    }
+    void println() { fputc('\n', stderr); }
+};
+
+inline HostSerial Serial;
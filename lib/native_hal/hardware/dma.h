@@ -0,0 +1,120 @@
+#pragma once
+/*
+ * Host stand-in for hardware/dma.h. Channels are handed out for anything, but only a
+ * transfer into an I2C data_cmd register actually runs: a thread paces it through the
+ * loopback bus in hardware/i2c.h and raises DMA_IRQ_1 at the end, like the real channel
+ * would. Every other transfer is accepted and never completes; the DSP path does not
+ * depend on one.
+ */
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+
+#include <atomic>
+#include <cstdint>
+#include <sys/types.h>
+#include <thread>
+
+#define HOST_DMA_CHANNELS 12
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+typedef struct {
+    uint32_t ctrl;
+} dma_channel_config;
+
+// Same bit positions as the RP2040's CTRL register, only the ones the host looks at
+#define HOST_DMA_SIZE_SHIFT 2
+#define HOST_DMA_INCR_READ  (1u << 4)
+
+struct host_dma_channel_t {
+    dma_channel_config config;
+    volatile void *write;
+    const volatile void *read;
+    uint count;
+    std::atomic<bool> busy{false};
+    std::atomic<bool> abort{false};
+    std::atomic<bool> irq1{false};
+    std::atomic<bool> irq1_status{false};
+};
+
+inline host_dma_channel_t host_dma[HOST_DMA_CHANNELS];
+
+inline int dma_claim_unused_channel(bool required) {
+    static int next_channel = 0;
+    return next_channel++;
+}
+
+inline dma_channel_config dma_channel_get_default_config(uint channel) {
+    return dma_channel_config{(DMA_SIZE_32 << HOST_DMA_SIZE_SHIFT) | HOST_DMA_INCR_READ};
+}
+inline void channel_config_set_transfer_data_size(dma_channel_config *c, dma_channel_transfer_size size) {
+    c->ctrl = (c->ctrl & ~(3u << HOST_DMA_SIZE_SHIFT)) | (size << HOST_DMA_SIZE_SHIFT);
+}
+inline void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    c->ctrl = incr ? c->ctrl | HOST_DMA_INCR_READ : c->ctrl & ~HOST_DMA_INCR_READ;
+}
+inline void channel_config_set_write_increment(dma_channel_config *c, bool incr) {}
+inline void channel_config_set_dreq(dma_channel_config *c, uint dreq) {}
+
+/**
+ * Runs a transfer on its own thread, if it's one the host knows how to run
+ */
+inline void dma_channel_start(uint channel) {
+    host_dma_channel_t *ch = &host_dma[channel];
+    i2c_inst_t *i2c        = nullptr;
+    for (uint bus = 0; bus < 2; bus++) {
+        if (ch->write == &host_i2c_hw[bus].data_cmd) i2c = &host_i2c_inst[bus];
+    }
+    if (i2c == nullptr) return;
+
+    ch->abort = false;
+    ch->busy  = true;
+    std::thread([ch, channel, i2c]() {
+        uint size     = 1 << ((ch->config.ctrl >> HOST_DMA_SIZE_SHIFT) & 3);
+        uint stride   = (ch->config.ctrl & HOST_DMA_INCR_READ) ? size : 0;
+        auto deadline = std::chrono::steady_clock::now();
+        const volatile uint8_t *read = (const volatile uint8_t *)ch->read;
+        for (uint i = 0; i < ch->count && !ch->abort; i++, read += stride) {
+            uint16_t word = size == 1 ? *read : *(const volatile uint16_t *)read;
+            host_i2c_clock(i2c, word, &deadline);
+        }
+
+        bool aborted = ch->abort;
+        ch->busy     = false;
+        if (aborted) return;
+        ch->irq1_status = true;
+        if (ch->irq1) host_irq_raise(DMA_IRQ_1);
+    }).detach();
+}
+
+inline void dma_channel_configure(uint channel,
+                                  const dma_channel_config *config,
+                                  volatile void *write_addr,
+                                  const volatile void *read_addr,
+                                  uint transfer_count,
+                                  bool trigger) {
+    host_dma[channel].config = *config;
+    host_dma[channel].write  = write_addr;
+    host_dma[channel].read   = read_addr;
+    host_dma[channel].count  = transfer_count;
+    if (trigger) dma_channel_start(channel);
+}
+
+inline void dma_channel_transfer_from_buffer_now(uint channel,
+                                                const volatile void *read_addr,
+                                                uint32_t transfer_count) {
+    host_dma[channel].read  = read_addr;
+    host_dma[channel].count = transfer_count;
+    dma_channel_start(channel);
+}
+
+inline bool dma_channel_is_busy(uint channel) { return host_dma[channel].busy; }
+
+inline void dma_channel_abort(uint channel) {
+    host_dma[channel].abort = true;
+    while (host_dma[channel].busy) std::this_thread::yield();
+}
+
+inline void dma_channel_set_irq1_enabled(uint channel, bool enabled) { host_dma[channel].irq1 = enabled; }
+inline bool dma_channel_get_irq1_status(uint channel) { return host_dma[channel].irq1_status; }
+inline void dma_channel_acknowledge_irq1(uint channel) { host_dma[channel].irq1_status = false; }
@@ -0,0 +1,67 @@
+#pragma once
+/*
+ * Host stand-in for hardware/i2c.h, a loopback bus. Words written to data_cmd by a DMA
+ * channel from hardware/dma.h are clocked out at the bus baud rate and handed a byte at
+ * a time to host_i2c_device, so a driver can be checked for ordering and overlap
+ * without a peripheral on the other end.
+ */
+#include <chrono>
+#include <cstdint>
+#include <sys/types.h>
+#include <thread>
+
+#define I2C_IC_DATA_CMD_STOP_BITS         0x00000200
+#define I2C_IC_DATA_CMD_RESTART_BITS      0x00000400
+#define I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS 0x00000040
+#define I2C_IC_ENABLE_ENABLE_BITS         0x00000001
+#define DREQ_I2C0_TX                      32
+#define DREQ_I2C1_TX                      34
+
+typedef struct {
+    volatile uint32_t tar;
+    volatile uint32_t enable;
+    volatile uint32_t data_cmd;
+    volatile uint32_t raw_intr_stat;
+    volatile uint32_t clr_tx_abrt;
+} i2c_hw_t;
+
+typedef struct i2c_inst {
+    i2c_hw_t *hw;
+    uint baudrate;
+    bool open; // a START has gone out and no STOP yet
+} i2c_inst_t;
+
+// Sees every byte on the bus, start is true for the first one after a START
+typedef void (*host_i2c_device_t)(uint8_t address, uint8_t byte, bool start);
+
+inline i2c_hw_t host_i2c_hw[2];
+inline i2c_inst_t host_i2c_inst[2]       = {{&host_i2c_hw[0], 100000, false}, {&host_i2c_hw[1], 100000, false}};
+inline host_i2c_device_t host_i2c_device = nullptr;
+
+#define i2c0 (&host_i2c_inst[0])
+#define i2c1 (&host_i2c_inst[1])
+
+inline i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c) { return i2c->hw; }
+inline uint i2c_hw_index(i2c_inst_t *i2c) { return i2c == i2c1; }
+inline uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx) { return i2c == i2c1 ? DREQ_I2C1_TX : DREQ_I2C0_TX; }
+
+inline uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    i2c->baudrate   = baudrate;
+    i2c->hw->enable = I2C_IC_ENABLE_ENABLE_BITS;
+    return baudrate;
+}
+
+/**
+ * Puts one data_cmd word on the bus, returning once it would have finished clocking out.
+ * Timing is against an absolute deadline so oversleeping on one byte is made up on the next.
+ */
+inline void host_i2c_clock(i2c_inst_t *i2c, uint16_t word, std::chrono::steady_clock::time_point *deadline) {
+    bool start = !i2c->open || (word & I2C_IC_DATA_CMD_RESTART_BITS);
+    if (host_i2c_device) host_i2c_device(i2c->hw->tar, word & 0xFF, start);
+    i2c->open = !(word & I2C_IC_DATA_CMD_STOP_BITS);
+
+    // 8 data bits and an ACK, plus the address byte and START/STOP when they happen
+    uint clocks = 9 + (start ? 10 : 0) + (i2c->open ? 0 : 1);
+    *deadline += std::chrono::nanoseconds(1000000000ull * clocks / i2c->baudrate);
+    std::this_thread::sleep_until(*deadline);
+}
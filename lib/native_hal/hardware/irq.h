@@ -0,0 +1,77 @@
+#pragma once
+/*
+ * Host stand-in for hardware/irq.h. Enabling an SIO FIFO interrupt starts a thread that
+ * acts as that core and runs the handler whenever its FIFO has data, which is how the
+ * other core sees it on the RP2040. Other interrupts run their handler on whichever
+ * thread raises them, see host_irq_raise().
+ */
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+
+#include <atomic>
+#include <thread>
+
+#define SIO_IRQ_PROC0 15
+#define SIO_IRQ_PROC1 16
+#define DMA_IRQ_0     11
+#define DMA_IRQ_1     12
+#define HOST_IRQ_COUNT 32
+#define PICO_LOWEST_IRQ_PRIORITY 0xff
+
+typedef void (*irq_handler_t)();
+
+inline irq_handler_t host_sio_handler[2]    = {nullptr, nullptr};
+inline std::atomic<bool> host_sio_running[2] = {false, false};
+inline irq_handler_t host_irq_handler[HOST_IRQ_COUNT]    = {nullptr};
+inline std::atomic<bool> host_irq_enabled[HOST_IRQ_COUNT] = {};
+
+inline void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    if (num == SIO_IRQ_PROC0 || num == SIO_IRQ_PROC1) host_sio_handler[num - SIO_IRQ_PROC0] = handler;
+    else if (num < HOST_IRQ_COUNT) host_irq_handler[num] = handler;
+}
+
+inline irq_handler_t irq_get_exclusive_handler(uint num) {
+    if (num == SIO_IRQ_PROC0 || num == SIO_IRQ_PROC1) return host_sio_handler[num - SIO_IRQ_PROC0];
+    if (num < HOST_IRQ_COUNT) return host_irq_handler[num];
+    return nullptr;
+}
+
+inline void irq_remove_handler(uint num, irq_handler_t handler) {
+    if (irq_get_exclusive_handler(num) != handler) return;
+    if (num == SIO_IRQ_PROC0 || num == SIO_IRQ_PROC1) host_sio_handler[num - SIO_IRQ_PROC0] = nullptr;
+    else host_irq_handler[num] = nullptr;
+}
+
+// Every host interrupt runs to completion on its own thread, there's nothing to preempt
+inline void irq_set_priority(uint num, uint8_t priority) {}
+
+/**
+ * Runs an interrupt's handler on the calling thread, once nothing has interrupts disabled
+ */
+inline void host_irq_raise(uint num) {
+    std::lock_guard<std::recursive_mutex> guard(host_irq_lock);
+    if (host_irq_enabled[num] && host_irq_handler[num]) host_irq_handler[num]();
+}
+
+inline void irq_set_enabled(uint num, bool enabled) {
+    if (num != SIO_IRQ_PROC0 && num != SIO_IRQ_PROC1) {
+        if (num < HOST_IRQ_COUNT) host_irq_enabled[num] = enabled;
+        return;
+    }
+    uint core = num - SIO_IRQ_PROC0;
+    if (!enabled || host_sio_running[core].exchange(true)) return;
+
+    // The new thread services the interrupt as this core, the caller carries on as the other one
+    host_core = core ^ 1;
+    std::thread([core]() {
+        host_core = core;
+        while (true) {
+            // Poll rather than sleep so the wakeup cost stays close to an interrupt
+            if (multicore_fifo_rvalid()) {
+                host_sio_handler[core]();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }).detach();
+}
@@ -0,0 +1,19 @@
+#pragma once
+/*
+ * Host stand-in for hardware/sync.h. Interrupt handlers from hardware/irq.h run on their
+ * own threads and take host_irq_lock first, so holding it is as good as having
+ * interrupts off.
+ */
+#include <atomic>
+#include <mutex>
+
+inline std::recursive_mutex host_irq_lock;
+
+inline void __dmb() { std::atomic_thread_fence(std::memory_order_seq_cst); }
+
+inline uint32_t save_and_disable_interrupts() {
+    host_irq_lock.lock();
+    return 0;
+}
+
+inline void restore_interrupts(uint32_t status) { host_irq_lock.unlock(); }
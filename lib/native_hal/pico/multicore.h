@@ -0,0 +1,53 @@
+#pragma once
+/*
+ * Host stand-in for pico/multicore.h. Each direction of the inter-core FIFO is a
+ * small lock-free ring; the thread running the SIO IRQ from hardware/irq.h plays
+ * core0 and every other thread plays core1.
+ */
+#include <atomic>
+#include <cstdint>
+#include <sys/types.h>
+#include <thread>
+
+#define HOST_FIFO_DEPTH 8 // matches the RP2040 SIO FIFO
+
+struct host_fifo_t {
+    uint32_t data[HOST_FIFO_DEPTH];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+};
+
+// fifo[n] is read by core n
+inline host_fifo_t host_fifo[2];
+inline thread_local uint host_core = 1;
+
+inline uint get_core_num() { return host_core; }
+
+inline bool multicore_fifo_rvalid() {
+    host_fifo_t &f = host_fifo[host_core];
+    return f.head.load(std::memory_order_acquire) != f.tail.load(std::memory_order_relaxed);
+}
+
+inline bool multicore_fifo_wready() {
+    host_fifo_t &f = host_fifo[host_core ^ 1];
+    return f.head.load(std::memory_order_relaxed) - f.tail.load(std::memory_order_acquire) < HOST_FIFO_DEPTH;
+}
+
+inline void multicore_fifo_push_blocking(uint32_t data) {
+    host_fifo_t &f = host_fifo[host_core ^ 1];
+    while (!multicore_fifo_wready()) std::this_thread::yield();
+    uint32_t head                    = f.head.load(std::memory_order_relaxed);
+    f.data[head % HOST_FIFO_DEPTH]   = data;
+    f.head.store(head + 1, std::memory_order_release);
+}
+
+inline uint32_t multicore_fifo_pop_blocking() {
+    host_fifo_t &f = host_fifo[host_core];
+    while (!multicore_fifo_rvalid()) std::this_thread::yield();
+    uint32_t tail = f.tail.load(std::memory_order_relaxed);
+    uint32_t data = f.data[tail % HOST_FIFO_DEPTH];
+    f.tail.store(tail + 1, std::memory_order_release);
+    return data;
+}
+
+inline void multicore_fifo_clear_irq() {}
@@ -0,0 +1,11 @@
+#pragma once
+/* Host stand-in for pico/stdlib.h */
+#include <cstdint>
+#include <sys/types.h>
+#include <thread>
+
+// Busy-waits on the device, but here the thing being waited for may need this CPU
+inline void tight_loop_contents() { std::this_thread::yield(); }
+
+// Host interrupts are plain function calls on some thread, so nothing ever looks like a handler
+inline uint __get_current_exception() { return 0; }
@@ -0,0 +1,25 @@
+#include "arena.h"
+
+// Global variables
+dsp_arena_t dsp_arena __attribute__((aligned(8)));
+
+/**
+ * @brief Logs how the DSP memory budget is spent
+ *
+ * @return uint32_t total bytes held by the DSP buffers, including the decimator's
+ */
+uint32_t arena_report() {
+    uint32_t decimator = sizeof(int16_t) * DECIMATION_MAX_TAPS * 3; // taps plus the doubled delay line
+    uint32_t total     = sizeof(dsp_arena) + decimator;
+
+    LOG_INFO("DSP memory at %d bits:", FFT_MAX_BITS);
+    LOG_INFO("  capture     %6u", (unsigned)sizeof(dsp_arena.capture));
+    LOG_INFO("  frame       %6u", (unsigned)sizeof(dsp_arena.frame));
+    LOG_INFO("  spectrum    %6u", (unsigned)sizeof(dsp_arena.spectrum));
+    LOG_INFO("  window      %6u", (unsigned)sizeof(dsp_arena.window));
+    LOG_INFO("  bit reverse %6u", (unsigned)sizeof(dsp_arena.bit_reverse));
+    LOG_INFO("  decimator   %6u", (unsigned)decimator);
+    LOG_INFO("  total       %6u of %u budgeted", (unsigned)total, (unsigned)DSP_ARENA_BUDGET);
+
+    return total;
+}
@@ -0,0 +1,1893 @@
+#include "capture.h"
+#include "decimate.h"
+#include "fft.h"
+#include "fft_engine.h"
+#include "framediff.h"
+#include "glyphs.h"
+#include "goertzel.h"
+#include "layer.h"
+#include "log.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "ssd1306.h"
+#include "stats.h"
+#include "yin.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#ifndef PROFILE
+#error "The benchmark times the do_fft() stages through the profile probes, see profile.h"
+#endif
+
+/*
+ * Host benchmark for the DSP path. Build and run with `pio run -e native -t exec`.
+ * A human readable table goes to stderr, the JSON baseline goes to stdout:
+ *
+ *   .pio/build/native/program > src/bench/baseline.json
+ */
+
+// Defined in fft.cpp, normally called from the mic DMA IRQ
+void mic_dma_handler(uint16_t *data);
+
+/* CONSTANTS */
+#define BENCH_MIN_BITS    FFT_MIN_BITS
+#define BENCH_MAX_BITS    14
+#define BENCH_SAMPLE_RATE (96000 * 2)
+#define BENCH_SAMPLES     (1 << 20) // samples pushed through each configuration
+#define BENCH_MIN_FRAMES  16
+#define BENCH_WARMUP      4
+#define BENCH_TONE        440.0
+#define BENCH_AMPLITUDE   1000.0
+#define BENCH_ENGINE_RUNS 32 // frames per tone when comparing pitch engines
+#define BENCH_PIPE_FRAMES 256 // frames pushed through the two-thread pipeline
+#define BENCH_NOTE_MIN    20    // Hz, freq2note() is checked against the reference at every fix15 step in between
+#define BENCH_NOTE_MAX    8000
+#define BENCH_NOTE_TIMED  (1 << 20) // evenly spaced inputs each freq2note() is timed on
+#define BENCH_NOTE_TOLERANCE 1 // cents freq2note() may be off the reference, a value right on .5 rounding either way
+#define BENCH_STATS_PUSHES (1 << 16) // samples pushed through each stats window length
+#define BENCH_STEP_FRAMES  24 // frames held on each side of a note step
+#define BENCH_STEP_JITTER  3.0 // cents of random detune added to every frame
+#define BENCH_STEP_SETTLED 10.0 // cents from the new tone that counts as settled
+#define BENCH_STEP_HOLD    12 // frames at the end of each side of a step that steadiness is judged on
+#define BENCH_STEP_WRONG   50.0 // cents off that would show the wrong note
+#define BENCH_DISPLAY_FRAMES 4096 // tuner screens pushed through the tile diff
+#define BENCH_I2C_HZ         400000
+#define BENCH_I2C_RUN_BYTES  8 // addressing, commands and the data header each tile run costs on the bus
+#define BENCH_BUS_FRAMES     256 // frames pushed through the loopback display bus, each way
+#define BENCH_RENDER_US      1000 // stand-in for U8g2 drawing a frame on the device
+#define BENCH_LAYER_FRAMES   4096 // frames drawn per visualizer, with and without a cached background
+#define BENCH_GLYPH_STRINGS  (1 << 14) // note names and numbers drawn each way
+#define BENCH_GLYPH_FILL     0x55 // every other row set, what the strings are drawn over
+#define BENCH_GLYPH_RUNS     1024 // most runs a stand-in glyph encodes to
+#define BENCH_LOG_PUSHES     (1 << 16) // records timed per argument count
+#define BENCH_LOG_RECORDS    (1 << 18) // records pushed from the other core while this one drains
+#define BENCH_LOG_BURST      16 // records the other core pushes back to back
+#define BENCH_PROFILE_SPANS  (1 << 16) // made up spans checked against the exact percentiles
+#define BENCH_LATENCY_BITS   10 // captures paced in real time, small so the run stays short
+#define BENCH_LATENCY_FRAMES 96 // pitch results traced from the mic to the loopback panel, each way
+#define BENCH_CAPTURE_SAMPLES 256 // samples in each simulated DMA transfer
+#define BENCH_CAPTURE_CHUNKS  8 // steps each transfer lands in, so a reader can catch one half written
+#define BENCH_CAPTURE_PERIOD  1000 // us per transfer
+#define BENCH_CAPTURE_FRAMES  400 // transfers per configuration
+#define BENCH_HOP_CAPTURES    128 // captures pushed through each hop size, after the history has filled
+#define BENCH_HOP_HARMONIC    600 // cents off past which a raw estimate locked onto a harmonic, counted apart
+
+/* TYPES */
+enum bench_visualizer_t { BENCH_CIRCULAR, BENCH_TRIANGLE, BENCH_BAR, BENCH_VISUALIZERS };
+
+// Stand-in for a compressed U8g2 glyph: a box of alternating clear and set runs, row by row
+typedef struct bench_glyph_t {
+    uint8_t w, h, advance;
+    int8_t dx, dy;
+    uint8_t runs[BENCH_GLYPH_RUNS];
+    uint16_t count;
+} bench_glyph_t;
+
+// Private defs
+static uint64_t __now_ns();
+static void __synth_frame(uint16_t *buf, uint16_t depth, double freq, uint32_t offset);
+static void __bench_fft(fft_kernel_t kernel,
+                        fft_input_t mode,
+                        uint16_t bits,
+                        uint8_t decimation,
+                        uint8_t cores,
+                        bool last);
+static void __bench_engine(bool yin, double tone, bool last);
+static void __bench_refine(double tone, bool last);
+static void __bench_window(fft_window_t window, bool last);
+static void __bench_format(uint8_t frac, bool last);
+static fix15 __run_tone(bool yin, double tone, uint64_t *elapsed);
+static void __bench_freq2note();
+static void __bench_stats(uint8_t window, bool last);
+static void __bench_settle(smooth_mode_t mode, bool last);
+static void __run_step(smooth_mode_t mode, double from, double to, double *cents);
+static void __bench_framediff();
+static void __count_tiles(uint8_t tx, uint8_t ty, uint8_t tw);
+static void __fill_rect(uint8_t *buffer, uint8_t x, uint8_t y, uint8_t w, uint8_t h);
+static void __draw_tuner(uint8_t *buffer, uint32_t frame, uint32_t *state);
+static void __bench_layers(bench_visualizer_t visualizer, bool last);
+static void __draw_background(uint8_t *buffer, bench_visualizer_t visualizer);
+static void __draw_scene(uint8_t *buffer, bench_visualizer_t visualizer, int8_t cents, uint8_t note);
+static void __draw_glyph(uint8_t *buffer, uint8_t x, uint8_t y, uint8_t w, uint8_t h);
+static void __invert_rect(uint8_t *buffer, uint8_t x, uint8_t y, uint8_t w, uint8_t h);
+static void __bench_glyphs();
+static void __encode_glyph(bench_glyph_t *glyph, char c, uint8_t w, uint8_t h, uint8_t advance);
+static void __decode_glyph(uint8_t *buffer, const bench_glyph_t *glyph, int16_t x, int16_t y);
+static uint8_t __decoded_width(bench_glyph_t glyphs[], const char *str);
+static void __bench_log();
+static void __bench_profile();
+static void __bench_ssd1306();
+static double __run_bus(bool overlap, uint32_t *order_errors, bool *matches);
+static void __ssd1306_device(uint8_t address, uint8_t byte, bool start);
+static void __send_stream(uint8_t tx, uint8_t ty, uint8_t tw);
+static void __bench_latency();
+static void __run_latency(bool overlap, bool last);
+static void __bench_hop(uint16_t hop, bool last);
+static void __bench_capture();
+static void __run_capture(uint8_t depth, double load, bool last);
+static void __bench_pipeline();
+
+// Global variables
+const char *STAGE_NAMES[FFT_STAGE_DONE] = {
+    "decimate", "ingest", "bitreverse", "butterfly", "split", "peak", "interpolate", "refine", "average"};
+const char *INPUT_NAMES[]  = {"complex", "real"};
+const char *KERNEL_NAMES[] = {"radix2", "radix4"};
+const char *WINDOW_NAMES[] = {"hann", "blackman-harris", "flat-top", "kaiser"};
+const double ENGINE_TONES[] = {41.20, 55.00, 82.41, 110.00, 146.83, 196.00, 246.94, 329.63, 440.00, 880.00};
+const double REFINE_CENTS[] = {-23.7, -8.2, 0.0, 3.1, 17.6};
+const char *SMOOTH_NAMES[]  = {"off", "rolling", "one-euro", "kalman"};
+const double STEP_TONES[]   = {466.16, 392.00, 880.00, 329.63}; // stepped to from A4
+const char *VISUALIZER_NAMES[] = {"circular", "triangle", "bar"};
+const double CAPTURE_LOADS[]   = {0.5, 0.9, 1.1}; // DSP time per capture, as a share of the capture period
+
+uint16_t bench_input[1 << BENCH_MAX_BITS];
+
+uint32_t noise_state = 1;
+uint32_t tile_runs   = 0;
+
+// Loopback SSD1306, what the panel would be showing
+uint8_t oled_ram[DISPLAY_BUFFER_SIZE];
+uint8_t oled_page = 0, oled_column = 0, oled_control = 0;
+bool oled_argument        = false;
+uint8_t oled_marker       = 0;
+uint32_t oled_order_errors = 0;
+const uint8_t *bus_frame  = NULL;
+
+int main() {
+    fprintf(stderr, "%-7s %-8s %-5s %-6s %-5s %-5s", "kernel", "input", "bits", "depth", "decim", "cores");
+    for (uint8_t s = 0; s < FFT_STAGE_DONE; s++) { fprintf(stderr, " %11s", STAGE_NAMES[s]); }
+    fprintf(stderr, " %11s %9s\n", "total", "freq");
+
+    printf("{\n  \"sample_rate\": %d,\n  \"tone_hz\": %.1f,\n  \"unit\": \"ns/frame\",\n  \"results\": [\n",
+           BENCH_SAMPLE_RATE,
+           BENCH_TONE);
+
+    for (uint8_t kernel = FFT_KERNEL_RADIX2; kernel <= FFT_KERNEL_RADIX4; kernel++) {
+        for (uint8_t mode = FFT_INPUT_COMPLEX; mode <= FFT_INPUT_REAL; mode++) {
+            for (uint16_t bits = BENCH_MIN_BITS; bits <= BENCH_MAX_BITS; bits++) {
+                __bench_fft((fft_kernel_t)kernel, (fft_input_t)mode, bits, 1, 1, false);
+            }
+        }
+    }
+
+    // Decimation sweep on the default kernel at the default depth
+    for (uint8_t factor = 1; factor <= DECIMATION_MAX_FACTOR; factor <<= 1) {
+        __bench_fft(FFT_KERNEL_RADIX4, FFT_INPUT_REAL, 12, factor, 1, false);
+    }
+
+    // Radix-4 passes split across a helper thread standing in for the other core
+    fft_parallel_helper_init();
+    for (uint8_t mode = FFT_INPUT_COMPLEX; mode <= FFT_INPUT_REAL; mode++) {
+        for (uint16_t bits = BENCH_MIN_BITS; bits <= BENCH_MAX_BITS; bits++) {
+            __bench_fft(FFT_KERNEL_RADIX4,
+                        (fft_input_t)mode,
+                        bits,
+                        1,
+                        2,
+                        mode == FFT_INPUT_REAL && bits == BENCH_MAX_BITS);
+        }
+    }
+
+    // Pitch engines head to head at the default configuration
+    fprintf(stderr, "\n%-7s %-9s %-9s %-8s %11s\n", "engine", "tone", "freq", "cents", "ns/frame");
+    printf("  ],\n  \"engines\": [\n");
+    uint8_t num_tones = sizeof(ENGINE_TONES) / sizeof(ENGINE_TONES[0]);
+    for (uint8_t yin = 0; yin <= 1; yin++) {
+        for (uint8_t t = 0; t < num_tones; t++) {
+            __bench_engine(yin, ENGINE_TONES[t], yin && t == num_tones - 1);
+        }
+    }
+
+    // Window tables traded off on accuracy and cost
+    fprintf(stderr, "\n%-16s %-10s %-10s %11s\n", "window", "mean|c|", "max|c|", "ns/frame");
+    printf("  ],\n  \"windows\": [\n");
+    for (uint8_t w = FFT_WINDOW_HANN; w <= FFT_WINDOW_KAISER; w++) {
+        __bench_window((fft_window_t)w, w == FFT_WINDOW_KAISER);
+    }
+
+    // The transform's fixed-point formats on the same tones
+    fprintf(stderr, "\n%-16s %-10s %-10s %11s\n", "format", "mean|c|", "max|c|", "ns/frame");
+    printf("  ],\n  \"formats\": [\n");
+    __bench_format(FFT_FRAC, false);
+    __bench_format(FFT_ALT_FRAC, true);
+
+    // Filter bank refinement of slightly detuned notes around A4
+    fprintf(stderr,
+            "\n%-9s %-9s %-9s %-9s %-9s %11s\n",
+            "tone",
+            "coarse",
+            "refined",
+            "c.cents",
+            "r.cents",
+            "ns/refine");
+    printf("  ],\n  \"refine\": [\n");
+    uint8_t num_offsets = sizeof(REFINE_CENTS) / sizeof(REFINE_CENTS[0]);
+    for (uint8_t t = 0; t < num_offsets; t++) {
+        __bench_refine(440.0 * pow(2, REFINE_CENTS[t] / 1200), t == num_offsets - 1);
+    }
+
+    // Streaming statistics against recomputing them from the whole window
+    fprintf(stderr,
+            "\n%-7s %-9s %-9s %-9s %-10s %-10s\n",
+            "window",
+            "push ns",
+            "naive ns",
+            "median",
+            "mean",
+            "var err");
+    printf("  ],\n  \"stats\": [\n");
+    for (uint8_t window = 8; window <= STATS_MAX_WINDOW; window <<= 1) {
+        __bench_stats(window, window == STATS_MAX_WINDOW);
+    }
+
+    // Smoothers on how fast they follow a note change and how steady they hold a note
+    fprintf(stderr,
+            "\n%-9s %-9s %-9s %-9s %-9s %-9s %-9s\n",
+            "smoothing",
+            "frames",
+            "max",
+            "lag",
+            "ms",
+            "glitches",
+            "jitter");
+    printf("  ],\n  \"settle\": [\n");
+    for (uint8_t mode = SMOOTH_OFF; mode < SMOOTH_COUNT; mode++) {
+        __bench_settle((smooth_mode_t)mode, mode == SMOOTH_COUNT - 1);
+    }
+
+    // Tuner screens started from a cached background against drawn from scratch
+    fprintf(stderr, "\n%-9s %-9s %-9s %-9s\n", "visual", "full ns", "layer ns", "mismatch");
+    printf("  ],\n  \"layers\": [\n");
+    for (uint8_t v = BENCH_CIRCULAR; v < BENCH_VISUALIZERS; v++) {
+        __bench_layers((bench_visualizer_t)v, v == BENCH_VISUALIZERS - 1);
+    }
+
+    // Sliding windows at shrinking hops against back to back frames, default configuration
+    fprintf(stderr,
+            "\n%-7s %-8s %-9s %-9s %-11s %-9s %-9s %s\n",
+            "hop",
+            "overlap",
+            "updates/s",
+            "ms",
+            "ns/result",
+            "load",
+            "mean|c|",
+            "harmonics");
+    printf("  ],\n  \"hops\": [\n");
+    for (uint16_t hop = 1 << 12; hop >= 1 << 8; hop >>= 1) {
+        __bench_hop(hop, hop == 1 << 8);
+    }
+
+    printf("  ],\n");
+    __bench_freq2note();
+    __bench_framediff();
+    __bench_glyphs();
+    __bench_log();
+    __bench_profile();
+    __bench_ssd1306();
+    __bench_latency();
+    __bench_capture();
+    __bench_pipeline();
+    printf("  \"memory\": {\"max_bits\": %d, \"bytes\": %u}\n", FFT_MAX_BITS, arena_report());
+
+    printf("}\n");
+    return 0;
+}
+
+/**
+ * @brief Times do_fft() stage by stage for one configuration and reports it
+ *
+ * @param kernel FFT butterfly kernel
+ * @param mode FFT input mode
+ * @param bits log2 of the capture depth
+ * @param decimation decimation factor
+ * @param cores 2 to split the radix-4 passes with the helper thread
+ * @param last true for the final JSON entry
+ */
+static void __bench_fft(fft_kernel_t kernel,
+                        fft_input_t mode,
+                        uint16_t bits,
+                        uint8_t decimation,
+                        uint8_t cores,
+                        bool last) {
+    uint16_t depth  = 1 << bits;
+    uint32_t frames = BENCH_SAMPLES >> bits;
+    if (frames < BENCH_MIN_FRAMES) frames = BENCH_MIN_FRAMES;
+
+    fft_init(bits, BENCH_SAMPLE_RATE);
+    fft_set_input_mode(mode);
+    fft_set_kernel(kernel);
+    fft_set_decimation(decimation);
+    fft_set_parallel(cores == 2);
+
+    // Each FFT frame needs one capture per decimation step
+    fix15 result     = 0;
+    uint32_t capture = 0;
+    for (uint32_t f = 0; f < frames + BENCH_WARMUP; f++) {
+        if (f == BENCH_WARMUP) profile_reset();
+        for (uint8_t d = 0; d < decimation; d++) {
+            __synth_frame(bench_input, depth, BENCH_TONE, capture++ * depth);
+            mic_dma_handler(bench_input);
+            result = do_fft();
+        }
+    }
+
+    fft_set_parallel(false);
+
+    uint64_t total = 0;
+    fprintf(stderr,
+            "%-7s %-8s %-5d %-6d %-5d %-5d",
+            KERNEL_NAMES[kernel],
+            INPUT_NAMES[mode],
+            bits,
+            depth,
+            decimation,
+            cores);
+    printf("    {\"kernel\": \"%s\", \"input\": \"%s\", \"bits\": %d, \"depth\": %d, \"decimation\": %d, "
+           "\"cores\": %d, \"frames\": %u, \"stages\": {",
+           KERNEL_NAMES[kernel],
+           INPUT_NAMES[mode],
+           bits,
+           depth,
+           decimation,
+           cores,
+           frames);
+    for (uint8_t s = 0; s < FFT_STAGE_DONE; s++) {
+        uint64_t per_frame = profile_get((profile_probe_t)s)->sum / frames;
+        total += per_frame;
+        fprintf(stderr, " %11llu", (unsigned long long)per_frame);
+        printf("%s\"%s\": %llu", s ? ", " : "", STAGE_NAMES[s], (unsigned long long)per_frame);
+    }
+    fprintf(stderr, " %11llu %9.2f\n", (unsigned long long)total, fix2float15(result));
+    printf("}, \"total\": %llu, \"freq_hz\": %.2f}%s\n",
+           (unsigned long long)total,
+           fix2float15(result),
+           last ? "" : ",");
+}
+
+/**
+ * @brief Runs the pipeline on a steady tone with a sliding window hop and reports how often
+ *        results come, what they cost and how close they are
+ * @remarks Set up as on the device: Goertzel refinement and the default smoothing run on
+ *          every window, and each result goes through freq2note() into the queue. Every
+ *          pipeline_step() is timed, the ones that only feed the history included, and the
+ *          load is host time over the length of audio pushed through. Results that locked
+ *          onto a harmonic are counted apart from the accuracy.
+ *
+ * @param hop decimated samples between windows, the frame length for back to back frames
+ * @param last true for the final JSON entry
+ */
+static void __bench_hop(uint16_t hop, bool last) {
+    uint16_t bits  = 12;
+    uint16_t depth = 1 << bits;
+
+    fft_init(bits, BENCH_SAMPLE_RATE);
+    fft_set_input_mode(FFT_INPUT_REAL);
+    fft_set_kernel(FFT_KERNEL_RADIX4);
+    fft_set_decimation(DECIMATION_FACTOR);
+    fft_set_hop(hop);
+    fft_set_refine(true);
+    fft_set_smoothing(SMOOTH_ROLLING);
+    pipeline_set_engine(ENGINE_FFT);
+    pipeline_set_center(440);
+    pipeline_init();
+
+    // The history and the rolling mean fill untimed, after that a window goes through
+    // ingest every time one is handed out
+    uint32_t warmup  = DECIMATION_FACTOR + 2 * ROLLING_ITEMS * hop / (depth / DECIMATION_FACTOR);
+    uint32_t capture = 0;
+    uint32_t windows = 0, results = 0, harmonics = 0;
+    uint64_t elapsed = 0;
+    double cents     = 0;
+    for (; capture < warmup + BENCH_HOP_CAPTURES; capture++) {
+        if (capture == warmup) {
+            profile_reset();
+            windows   = 0;
+            results   = 0;
+            harmonics = 0;
+            elapsed   = 0;
+            cents     = 0;
+        }
+        __synth_frame(bench_input, depth, BENCH_TONE, capture * depth);
+        mic_dma_handler(bench_input);
+        for (uint32_t seen = profile_get(PROFILE_INGEST)->count;; seen++) {
+            uint64_t start = __now_ns();
+            pipeline_step();
+            elapsed += __now_ns() - start;
+            if (profile_get(PROFILE_INGEST)->count == seen) break;
+
+            windows++;
+            pitch_result_t result;
+            if (!pipeline_pop(&result)) continue; // the rolling mean held it back
+            results++;
+            double off = fabs(1200 * log2(fix2float15(result.frequency) / BENCH_TONE));
+            if (off > BENCH_HOP_HARMONIC) {
+                harmonics++;
+            } else {
+                cents += off;
+            }
+        }
+    }
+    fft_set_hop(0);
+    fft_set_refine(false);
+
+    double audio_s   = (double)BENCH_HOP_CAPTURES * depth / BENCH_SAMPLE_RATE;
+    double overlap   = 100.0 * (depth - hop) / depth;
+    double per_s     = windows / audio_s;
+    double update_ms = windows ? audio_s * 1000 / windows : 0;
+    double ns        = windows ? (double)elapsed / windows : 0;
+    double load      = elapsed / (audio_s * 1e9);
+    double mean      = results > harmonics ? cents / (results - harmonics) : 0;
+    fprintf(stderr,
+            "%-7u %-8.1f %-9.1f %-9.2f %-11.0f %-9.4f %-9.3f %u\n",
+            hop,
+            overlap,
+            per_s,
+            update_ms,
+            ns,
+            load,
+            mean,
+            harmonics);
+    printf("    {\"hop\": %u, \"overlap_pct\": %.1f, \"windows\": %u, \"updates_per_s\": %.1f, \"update_ms\": %.2f, "
+           "\"ns_per_window\": %.0f, \"load\": %.4f, \"mean_abs_cents\": %.3f, \"harmonics\": %u}%s\n",
+           hop,
+           overlap,
+           windows,
+           per_s,
+           update_ms,
+           ns,
+           load,
+           mean,
+           harmonics,
+           last ? "" : ",");
+}
+
+/**
+ * @brief Runs one pitch engine on a steady tone and reports time and accuracy
+ *
+ * @param yin true for do_yin(), false for do_fft()
+ * @param tone test frequency in Hz
+ * @param last true for the final JSON entry
+ */
+static void __bench_engine(bool yin, double tone, bool last) {
+    uint64_t elapsed = 0;
+    fix15 result     = __run_tone(yin, tone, &elapsed);
+
+    double freq  = fix2float15(result);
+    double cents = freq > 0 ? 1200 * log2(freq / tone) : 0;
+    fprintf(stderr,
+            "%-7s %-9.2f %-9.2f %-8.1f %11llu\n",
+            yin ? "yin" : "fft",
+            tone,
+            freq,
+            cents,
+            (unsigned long long)(elapsed / BENCH_ENGINE_RUNS));
+    printf("    {\"engine\": \"%s\", \"tone_hz\": %.2f, \"freq_hz\": %.2f, \"cents_error\": %.1f, \"total\": %llu}%s\n",
+           yin ? "yin" : "fft",
+           tone,
+           freq,
+           cents,
+           (unsigned long long)(elapsed / BENCH_ENGINE_RUNS),
+           last ? "" : ",");
+}
+
+/**
+ * @brief Compares the windows on peak accuracy across the engine tones and on FFT time
+ *
+ * @param window window under test
+ * @param last true for the final JSON entry
+ */
+static void __bench_window(fft_window_t window, bool last) {
+    fft_set_window(window);
+
+    double sum_cents = 0, max_cents = 0;
+    uint64_t elapsed = 0;
+    uint8_t num_tones = sizeof(ENGINE_TONES) / sizeof(ENGINE_TONES[0]);
+    for (uint8_t t = 0; t < num_tones; t++) {
+        fix15 result = __run_tone(false, ENGINE_TONES[t], &elapsed);
+        double cents = result > 0 ? fabs(1200 * log2(fix2float15(result) / ENGINE_TONES[t])) : 1200;
+        sum_cents += cents;
+        if (cents > max_cents) max_cents = cents;
+    }
+    fft_set_window(FFT_WINDOW_HANN);
+
+    uint64_t per_frame = elapsed / (num_tones * BENCH_ENGINE_RUNS);
+    fprintf(stderr,
+            "%-16s %-10.1f %-10.1f %11llu\n",
+            WINDOW_NAMES[window],
+            sum_cents / num_tones,
+            max_cents,
+            (unsigned long long)per_frame);
+    printf("    {\"window\": \"%s\", \"mean_abs_cents\": %.1f, \"max_abs_cents\": %.1f, \"total\": %llu}%s\n",
+           WINDOW_NAMES[window],
+           sum_cents / num_tones,
+           max_cents,
+           (unsigned long long)per_frame,
+           last ? "" : ",");
+}
+
+/**
+ * @brief Compares the FFT's fixed-point formats on peak accuracy across the engine tones and on FFT time
+ *
+ * @param frac fractional bits, FFT_FRAC or FFT_ALT_FRAC
+ * @param last true for the final JSON entry
+ */
+static void __bench_format(uint8_t frac, bool last) {
+    fft_set_format(frac);
+
+    double sum_cents = 0, max_cents = 0;
+    uint64_t elapsed  = 0;
+    uint8_t num_tones = sizeof(ENGINE_TONES) / sizeof(ENGINE_TONES[0]);
+    for (uint8_t t = 0; t < num_tones; t++) {
+        fix15 result = __run_tone(false, ENGINE_TONES[t], &elapsed);
+        double cents = result > 0 ? fabs(1200 * log2(fix2float15(result) / ENGINE_TONES[t])) : 1200;
+        sum_cents += cents;
+        if (cents > max_cents) max_cents = cents;
+    }
+    fft_set_format(FFT_FRAC);
+
+    char name[8];
+    snprintf(name, sizeof(name), "Q%u", frac);
+    uint64_t per_frame = elapsed / (num_tones * BENCH_ENGINE_RUNS);
+    fprintf(stderr,
+            "%-16s %-10.1f %-10.1f %11llu\n",
+            name,
+            sum_cents / num_tones,
+            max_cents,
+            (unsigned long long)per_frame);
+    printf("    {\"format\": \"%s\", \"mean_abs_cents\": %.1f, \"max_abs_cents\": %.1f, \"total\": %llu}%s\n",
+           name,
+           sum_cents / num_tones,
+           max_cents,
+           (unsigned long long)per_frame,
+           last ? "" : ",");
+}
+
+/**
+ * @brief Feeds a steady tone through a pitch engine at the default configuration
+ *
+ * @param yin true for do_yin(), false for do_fft()
+ * @param tone test frequency in Hz
+ * @param elapsed incremented by the time spent in the engine, over BENCH_ENGINE_RUNS frames
+ * @return fix15 the engine's final estimate
+ */
+static fix15 __run_tone(bool yin, double tone, uint64_t *elapsed) {
+    uint16_t bits  = 12;
+    uint16_t depth = 1 << bits;
+
+    fft_init(bits, BENCH_SAMPLE_RATE);
+    fft_set_input_mode(FFT_INPUT_REAL);
+    fft_set_kernel(FFT_KERNEL_RADIX4);
+    fft_set_decimation(DECIMATION_FACTOR);
+    fft_reset_smoothing();
+
+    // Time every call, including the ones that only decimate
+    fix15 result     = 0;
+    uint32_t capture = 0;
+    for (uint32_t f = 0; f < BENCH_ENGINE_RUNS; f++) {
+        for (uint8_t d = 0; d < DECIMATION_FACTOR; d++) {
+            __synth_frame(bench_input, depth, tone, capture++ * depth);
+            mic_dma_handler(bench_input);
+            uint64_t start = __now_ns();
+            result         = yin ? do_yin() : do_fft();
+            *elapsed += __now_ns() - start;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Runs the FFT engine on a steady tone, then refines the last frame with the filter bank
+ *
+ * @param tone test frequency in Hz
+ * @param last true for the final JSON entry
+ */
+static void __bench_refine(double tone, bool last) {
+    uint16_t bits  = 12;
+    uint16_t depth = 1 << bits;
+
+    fft_init(bits, BENCH_SAMPLE_RATE);
+    change_fft_center(440);
+    fft_set_decimation(DECIMATION_FACTOR);
+    fft_reset_smoothing();
+
+    fix15 coarse     = 0;
+    uint32_t capture = 0;
+    for (uint32_t f = 0; f < BENCH_ENGINE_RUNS; f++) {
+        for (uint8_t d = 0; d < DECIMATION_FACTOR; d++) {
+            __synth_frame(bench_input, depth, tone, capture++ * depth);
+            mic_dma_handler(bench_input);
+            coarse = do_fft();
+        }
+    }
+
+    uint8_t index;
+    int8_t cents;
+    freq2note(coarse, &index, &cents);
+    uint64_t start  = __now_ns();
+    fix15 refined   = goertzel_refine(coarse, index);
+    uint64_t elapse = __now_ns() - start;
+
+    double coarse_cents  = 1200 * log2(fix2float15(coarse) / tone);
+    double refined_cents = 1200 * log2(fix2float15(refined) / tone);
+    fprintf(stderr,
+            "%-9.2f %-9.2f %-9.2f %-9.2f %-9.2f %11llu\n",
+            tone,
+            fix2float15(coarse),
+            fix2float15(refined),
+            coarse_cents,
+            refined_cents,
+            (unsigned long long)elapse);
+    printf("    {\"tone_hz\": %.2f, \"coarse_cents_error\": %.2f, \"refined_cents_error\": %.2f, \"total\": %llu}%s\n",
+           tone,
+           coarse_cents,
+           refined_cents,
+           (unsigned long long)elapse,
+           last ? "" : ",");
+}
+
+/**
+ * @brief Checks the fixed-point freq2note() against the double reference and times both
+ * @remarks Every fix15 value from BENCH_NOTE_MIN to BENCH_NOTE_MAX is compared, including
+ *          the ones sharp of B7 where both are meant to leave their outputs alone. Each
+ *          answer is taken as cents above C0 so a note flipped at the halfway point only
+ *          counts for its rounding. Anything more than BENCH_NOTE_TOLERANCE cents apart, or
+ *          answered by one side only away from the ends of the table, is a mismatch.
+ */
+static void __bench_freq2note() {
+    change_fft_center(440);
+
+    uint64_t checked = 0, differ = 0, mismatches = 0;
+    for (fix15 freq = int2fix15(BENCH_NOTE_MIN); freq <= int2fix15(BENCH_NOTE_MAX); freq++) {
+        uint8_t ref_index = 0xFF, index = 0xFF;
+        int8_t ref_cents = INT8_MAX, cents = INT8_MAX;
+        freq2note_reference(freq, &ref_index, &ref_cents);
+        freq2note(freq, &index, &cents);
+        checked++;
+        if (index == ref_index && cents == ref_cents) continue;
+        differ++;
+
+        // Positive cents are flat of the note
+        int32_t ref_total = ref_index * 100 - ref_cents, total = index * 100 - cents;
+        if (index == 0xFF || ref_index == 0xFF) {
+            int32_t answered = index == 0xFF ? ref_total : total;
+            int32_t top      = (12 * NUM_OCTAVES - 1) * 100;
+            if (abs(answered) > BENCH_NOTE_TOLERANCE && abs(answered - top) > BENCH_NOTE_TOLERANCE) mismatches++;
+        } else if (abs(total - ref_total) > BENCH_NOTE_TOLERANCE) {
+            mismatches++;
+        }
+    }
+
+    // Same inputs through each, summed so neither loop can be optimised away
+    fix15 step            = (int2fix15(BENCH_NOTE_MAX) - int2fix15(BENCH_NOTE_MIN)) / BENCH_NOTE_TIMED;
+    uint64_t elapse[2]    = {0};
+    volatile uint32_t sum = 0;
+    for (uint8_t fixed = 0; fixed <= 1; fixed++) {
+        uint64_t start = __now_ns();
+        for (fix15 freq = int2fix15(BENCH_NOTE_MIN); freq < int2fix15(BENCH_NOTE_MAX); freq += step) {
+            uint8_t index = 0;
+            int8_t cents  = 0;
+            if (fixed) {
+                freq2note(freq, &index, &cents);
+            } else {
+                freq2note_reference(freq, &index, &cents);
+            }
+            sum = sum + index + cents;
+        }
+        elapse[fixed] = __now_ns() - start;
+    }
+    double reference_ns = (double)elapse[0] / BENCH_NOTE_TIMED;
+    double fixed_ns     = (double)elapse[1] / BENCH_NOTE_TIMED;
+
+    fprintf(stderr,
+            "\nfreq2note: %llu inputs, %llu differ, %llu past %d cent, %.1f ns reference, %.1f ns fixed-point\n",
+            (unsigned long long)checked,
+            (unsigned long long)differ,
+            (unsigned long long)mismatches,
+            BENCH_NOTE_TOLERANCE,
+            reference_ns,
+            fixed_ns);
+    printf("  \"freq2note\": {\"checked\": %llu, \"tolerance_cents\": %d, \"differ\": %llu, \"mismatches\": %llu, "
+           "\"reference_ns\": %.1f, \"fixed_ns\": %.1f},\n",
+           (unsigned long long)checked,
+           BENCH_NOTE_TOLERANCE,
+           (unsigned long long)differ,
+           (unsigned long long)mismatches,
+           reference_ns,
+           fixed_ns);
+}
+
+/**
+ * @brief Streams pitch-like samples through a stats_t and checks it against brute force
+ * @remarks The naive side re-sums and re-sorts the whole window every sample, which is what
+ *          the smoother's cost used to grow with. Mean and median have to match exactly,
+ *          the variance error is reported in Hz^2.
+ *
+ * @param window stats window length
+ * @param last true for the final JSON entry
+ */
+static void __bench_stats(uint8_t window, bool last) {
+    static stats_t stats;
+    fix15 history[STATS_MAX_WINDOW];
+    fix15 sorted[STATS_MAX_WINDOW];
+    stats_init(&stats, window);
+
+    // A wandering pitch with jitter and the odd octave jump, from its own generator
+    uint32_t state = 12345;
+    fix15 samples[BENCH_STATS_PUSHES];
+    for (uint32_t i = 0; i < BENCH_STATS_PUSHES; i++) {
+        state         = state * 1664525 + 1013904223;
+        double pitch  = 220 + 100 * sin(i / 500.0) + ((state >> 16) & 0xFF) / 64.0;
+        if ((state >> 8) % 97 == 0) pitch *= 2;
+        samples[i] = float2fix15(pitch);
+    }
+
+    uint64_t start = __now_ns();
+    fix15 sink     = 0;
+    for (uint32_t i = 0; i < BENCH_STATS_PUSHES; i++) {
+        stats_push(&stats, samples[i]);
+        sink += stats_mean(&stats) + stats_median(&stats);
+    }
+    double push_ns = (double)(__now_ns() - start) / BENCH_STATS_PUSHES;
+
+    // Brute force over the same stream, checked against a fresh stats_t as it goes
+    stats_init(&stats, window);
+    uint32_t median_errors = 0, mean_errors = 0;
+    double max_var_error = 0;
+    uint64_t naive       = 0;
+    for (uint32_t i = 0; i < BENCH_STATS_PUSHES; i++) {
+        stats_push(&stats, samples[i]);
+        history[i % window] = samples[i];
+        uint8_t count       = i + 1 < window ? i + 1 : window;
+
+        start       = __now_ns();
+        int64_t sum = 0;
+        for (uint8_t k = 0; k < count; k++) sum += history[k];
+        memcpy(sorted, history, count * sizeof(fix15));
+        std::sort(sorted, sorted + count);
+        fix15 median = (count & 1) ? sorted[count / 2]
+                                   : sorted[count / 2 - 1] + ((sorted[count / 2] - sorted[count / 2 - 1]) >> 1);
+        naive += __now_ns() - start;
+
+        double mean = (double)sum / count, var = 0;
+        for (uint8_t k = 0; k < count; k++) var += pow(fix2float15(history[k]) - mean / 32768, 2);
+        var /= count;
+
+        if (stats_median(&stats) != median) median_errors++;
+        if (stats_mean(&stats) != (fix15)((sum << STATS_MEAN_BITS) / count >> STATS_MEAN_BITS)) mean_errors++;
+        double var_error = fabs(fix2float15(stats_variance(&stats)) - var);
+        if (var_error > max_var_error) max_var_error = var_error;
+    }
+    double naive_ns = (double)naive / BENCH_STATS_PUSHES;
+
+    fprintf(stderr,
+            "%-7d %-9.1f %-9.1f %-9u %-10u %-10.4f\n",
+            window,
+            push_ns,
+            naive_ns,
+            median_errors,
+            mean_errors,
+            max_var_error);
+    printf("    {\"window\": %d, \"push_ns\": %.1f, \"naive_ns\": %.1f, \"median_errors\": %u, \"mean_errors\": %u, "
+           "\"max_variance_error\": %.4f}%s\n",
+           window,
+           push_ns,
+           naive_ns,
+           median_errors,
+           mean_errors,
+           max_var_error,
+           last ? "" : ",");
+    if (sink == 1) fprintf(stderr, " ");
+}
+
+/**
+ * @brief Steps the FFT engine from A4 to each of STEP_TONES and times how long a smoother takes to follow
+ * @remarks Every frame is detuned by up to BENCH_STEP_JITTER cents so there's something to
+ *          smooth, and everything is measured against the tones actually played. Settling is
+ *          the first frame after the step within BENCH_STEP_SETTLED cents of the new tone, and
+ *          lag is how many frames later that is than for the unsmoothed estimates of the same
+ *          input, so SMOOTH_OFF is the zero-lag reference. Steadiness is judged on the last
+ *          BENCH_STEP_HOLD frames before and after each step whatever the mode: frames more than
+ *          BENCH_STEP_WRONG cents off count as glitches and go into the RMS jitter at that cap.
+ *
+ * @param mode smoothing under test
+ * @param last true for the final JSON entry
+ */
+static void __bench_settle(smooth_mode_t mode, bool last) {
+    double raw[2 * BENCH_STEP_FRAMES], smoothed[2 * BENCH_STEP_FRAMES];
+    uint8_t num_steps     = sizeof(STEP_TONES) / sizeof(STEP_TONES[0]);
+    uint32_t total_frames = 0, max_frames = 0, glitches = 0, held = 0;
+    int32_t total_lag     = 0;
+    double jitter         = 0;
+
+    for (uint8_t s = 0; s < num_steps; s++) {
+        __run_step(SMOOTH_OFF, 440.0, STEP_TONES[s], raw);
+        __run_step(mode, 440.0, STEP_TONES[s], smoothed);
+
+        uint8_t f = BENCH_STEP_FRAMES, r = BENCH_STEP_FRAMES;
+        while (f < 2 * BENCH_STEP_FRAMES && fabs(smoothed[f]) > BENCH_STEP_SETTLED) f++;
+        while (r < 2 * BENCH_STEP_FRAMES && fabs(raw[r]) > BENCH_STEP_SETTLED) r++;
+        uint32_t frames = f - BENCH_STEP_FRAMES + 1;
+        total_frames += frames;
+        total_lag += (int32_t)f - r;
+        if (frames > max_frames) max_frames = frames;
+
+        // Frames before the step were measured from the tone after it
+        double offset = 1200 * log2(STEP_TONES[s] / 440.0);
+        for (uint8_t h = 0; h < 2 * BENCH_STEP_HOLD; h++) {
+            uint8_t frame = h < BENCH_STEP_HOLD ? BENCH_STEP_FRAMES - BENCH_STEP_HOLD + h
+                                                : 2 * BENCH_STEP_FRAMES - 2 * BENCH_STEP_HOLD + h;
+            double error  = fabs(smoothed[frame] + (frame < BENCH_STEP_FRAMES ? offset : 0));
+            if (error > BENCH_STEP_WRONG) {
+                glitches++;
+                error = BENCH_STEP_WRONG;
+            }
+            jitter += error * error;
+            held++;
+        }
+    }
+    jitter = sqrt(jitter / held);
+
+    // 12-bit frames decimated by DECIMATION_FACTOR, the configuration __run_step() uses
+    double frame_ms = 1000.0 * DECIMATION_FACTOR * (1 << 12) / BENCH_SAMPLE_RATE;
+    double mean     = (double)total_frames / num_steps;
+    double lag      = (double)total_lag / num_steps;
+    fprintf(stderr,
+            "%-9s %-9.2f %-9u %-9.2f %-9.1f %-9u %-9.2f\n",
+            SMOOTH_NAMES[mode],
+            mean,
+            max_frames,
+            lag,
+            mean * frame_ms,
+            glitches,
+            jitter);
+    printf("    {\"smoothing\": \"%s\", \"settle_frames\": %.2f, \"max_settle_frames\": %u, \"lag_frames\": %.2f, "
+           "\"settle_ms\": %.1f, \"glitches\": %u, \"jitter_cents\": %.2f}%s\n",
+           SMOOTH_NAMES[mode],
+           mean,
+           max_frames,
+           lag,
+           mean * frame_ms,
+           glitches,
+           jitter,
+           last ? "" : ",");
+}
+
+/**
+ * @brief Holds one tone for BENCH_STEP_FRAMES frames, then another, through do_fft()
+ *
+ * @param mode smoothing to run
+ * @param from tone before the step in Hz
+ * @param to tone after the step in Hz
+ * @param cents every frame's output in cents from `to`, 2 * BENCH_STEP_FRAMES entries
+ */
+static void __run_step(smooth_mode_t mode, double from, double to, double *cents) {
+    uint16_t bits  = 12;
+    uint16_t depth = 1 << bits;
+
+    fft_init(bits, BENCH_SAMPLE_RATE);
+    fft_set_decimation(DECIMATION_FACTOR);
+    fft_set_smoothing(mode);
+    change_fft_center(440);
+    fft_set_refine(true);
+
+    // The same detuning every run, so each smoother sees identical input
+    uint32_t state   = 777;
+    uint32_t capture = 0;
+    for (uint8_t f = 0; f < 2 * BENCH_STEP_FRAMES; f++) {
+        state         = state * 1664525 + 1013904223;
+        double detune = ((state >> 8) / (double)(1 << 24) * 2 - 1) * BENCH_STEP_JITTER;
+        double tone   = (f < BENCH_STEP_FRAMES ? from : to) * pow(2, detune / 1200);
+
+        fix15 result = 0;
+        for (uint8_t d = 0; d < DECIMATION_FACTOR; d++) {
+            __synth_frame(bench_input, depth, tone, capture++ * depth);
+            mic_dma_handler(bench_input);
+            result = do_fft();
+        }
+        cents[f] = result > 0 ? 1200 * log2(fix2float15(result) / to) : 0;
+    }
+    fft_set_smoothing(SMOOTH_ROLLING);
+    fft_set_refine(false);
+}
+
+/**
+ * @brief Draws bar tuner frames and measures what the tile diff sends compared to a full sendBuffer()
+ * @remarks Bus time assumes 9 clocks a byte plus BENCH_I2C_RUN_BYTES for each run.
+ */
+static void __bench_framediff() {
+    static framediff_t diff;
+    static uint8_t buffer[DISPLAY_BUFFER_SIZE];
+    framediff_invalidate(&diff);
+
+    uint32_t state = 4242, bytes = 0;
+    uint64_t flush = 0;
+    tile_runs      = 0;
+    for (uint32_t f = 0; f < BENCH_DISPLAY_FRAMES; f++) {
+        __draw_tuner(buffer, f, &state);
+
+        uint64_t start = __now_ns();
+        bytes += framediff_flush(&diff, buffer, __count_tiles);
+        flush += __now_ns() - start;
+    }
+
+    double per_frame = (double)bytes / BENCH_DISPLAY_FRAMES;
+    double runs      = (double)tile_runs / BENCH_DISPLAY_FRAMES;
+    double bus_us    = (per_frame + runs * BENCH_I2C_RUN_BYTES) * 9 * 1e6 / BENCH_I2C_HZ;
+    double full_us   = (DISPLAY_BUFFER_SIZE + DISPLAY_TILE_ROWS * BENCH_I2C_RUN_BYTES) * 9 * 1e6 / BENCH_I2C_HZ;
+    fprintf(stderr,
+            "\nframediff: %.0f of %d bytes/frame in %.1f runs, %.0f us on the bus vs %.0f us, %.0f ns/flush\n",
+            per_frame,
+            DISPLAY_BUFFER_SIZE,
+            runs,
+            bus_us,
+            full_us,
+            (double)flush / BENCH_DISPLAY_FRAMES);
+    printf("  \"framediff\": {\"bytes_per_frame\": %.0f, \"full_bytes\": %d, \"runs_per_frame\": %.1f, "
+           "\"bus_us\": %.0f, \"full_bus_us\": %.0f, \"flush_ns\": %.0f},\n",
+           per_frame,
+           DISPLAY_BUFFER_SIZE,
+           runs,
+           bus_us,
+           full_us,
+           (double)flush / BENCH_DISPLAY_FRAMES);
+}
+
+/**
+ * @brief Streams tuner frames to a loopback SSD1306, blocking on each one and then overlapped
+ * @remarks Each frame spins for BENCH_RENDER_US to stand in for U8g2 drawing it. The panel
+ *          model checks that the frame counter drawn in the corner arrives in order, frames
+ *          replaced while queued aside, and that it ends up showing the last frame exactly.
+ */
+static void __bench_ssd1306() {
+    i2c_init(i2c0, 400000);
+    host_i2c_device = __ssd1306_device;
+    ssd1306_init(i2c0, 0x3C);
+
+    uint32_t blocking_errors = 0, overlap_errors = 0;
+    bool blocking_matches = false, overlap_matches = false;
+    double blocking = __run_bus(false, &blocking_errors, &blocking_matches);
+    double overlap  = __run_bus(true, &overlap_errors, &overlap_matches);
+    host_i2c_device = NULL;
+
+    const ssd1306_stats_t *stats = ssd1306_stats();
+    fprintf(stderr,
+            "ssd1306: %.0f us/frame blocking, %.0f us/frame overlapped, %u waits, %u replaced, %u order errors, "
+            "panel %s\n",
+            blocking,
+            overlap,
+            (unsigned)stats->waits,
+            (unsigned)stats->replaced,
+            blocking_errors + overlap_errors,
+            blocking_matches && overlap_matches ? "matches" : "DIFFERS");
+    printf("  \"ssd1306\": {\"blocking_us\": %.0f, \"overlapped_us\": %.0f, \"render_us\": %d, \"waits\": %u, "
+           "\"replaced\": %u, \"order_errors\": %u, \"panel_matches\": %s},\n",
+           blocking,
+           overlap,
+           BENCH_RENDER_US,
+           (unsigned)stats->waits,
+           (unsigned)stats->replaced,
+           blocking_errors + overlap_errors,
+           blocking_matches && overlap_matches ? "true" : "false");
+}
+
+/**
+ * @brief Renders and sends BENCH_BUS_FRAMES frames through the DMA transport
+ *
+ * @param overlap false to wait for each frame to reach the panel before drawing the next
+ * @param order_errors set to the number of frames the panel saw out of order
+ * @param matches set to whether the panel shows the last frame
+ * @return double microseconds per frame
+ */
+static double __run_bus(bool overlap, uint32_t *order_errors, bool *matches) {
+    static framediff_t diff;
+    static uint8_t buffer[DISPLAY_BUFFER_SIZE];
+    uint32_t state = 4242;
+    framediff_invalidate(&diff);
+    bus_frame = buffer;
+
+    // The first frame goes out whole, so it's left out of the timing
+    oled_marker       = 0;
+    oled_order_errors = 0;
+    uint64_t start    = 0;
+    for (uint32_t f = 0; f <= BENCH_BUS_FRAMES; f++) {
+        if (f == 1) start = __now_ns();
+
+        __draw_tuner(buffer, f, &state);
+        buffer[0] = f % 255 + 1; // frame counter, in a column nothing else draws to
+        for (uint64_t until = __now_ns() + BENCH_RENDER_US * 1000; __now_ns() < until;) {}
+
+        if (ssd1306_begin()) framediff_retract(&diff);
+        framediff_flush(&diff, buffer, __send_stream);
+        ssd1306_commit();
+        if (!overlap || f == 0) ssd1306_wait();
+    }
+    ssd1306_wait();
+    double per_frame = (__now_ns() - start) / 1000.0 / BENCH_BUS_FRAMES;
+
+    *order_errors = oled_order_errors;
+    *matches      = memcmp(oled_ram, buffer, DISPLAY_BUFFER_SIZE) == 0;
+    return per_frame;
+}
+
+/**
+ * @brief Traces pitch results from the mic DMA swap to the loopback panel, with the
+ *        display waiting on the bus and overlapping it
+ */
+static void __bench_latency() {
+    fprintf(stderr, "\n%-9s %-9s %-9s %-9s %-9s %-9s\n", "display", "shown", "dropped", "mean us", "p99 us", "max us");
+    printf("  \"latency\": [\n");
+    __run_latency(false, false);
+    __run_latency(true, true);
+    printf("  ],\n");
+}
+
+/**
+ * @brief Runs the pipeline on captures paced like the ADC's, drawing and sending every
+ *        newest result the way do_tuner() does, and reports what the latency trace saw
+ *
+ * @param overlap false to wait for each frame to reach the panel before drawing the next
+ * @param last true for the final JSON entry
+ */
+static void __run_latency(bool overlap, bool last) {
+    static framediff_t diff;
+    static uint8_t buffer[DISPLAY_BUFFER_SIZE];
+    uint16_t depth = 1 << BENCH_LATENCY_BITS;
+
+    fft_init(BENCH_LATENCY_BITS, BENCH_SAMPLE_RATE);
+    fft_set_decimation(DECIMATION_FACTOR);
+    pipeline_set_engine(ENGINE_FFT);
+    pipeline_set_center(440);
+    pipeline_init();
+    framediff_invalidate(&diff);
+    bus_frame       = buffer;
+    host_i2c_device = __ssd1306_device;
+
+    // The first frame goes out whole, which the device only does once
+    uint32_t state = 4242, frame = 0;
+    __draw_tuner(buffer, frame++, &state);
+    ssd1306_begin();
+    framediff_flush(&diff, buffer, __send_stream);
+    ssd1306_commit();
+    ssd1306_wait();
+    profile_reset();
+
+    std::atomic<bool> producing(true);
+    std::thread core1([depth, &producing]() {
+        static uint16_t capture_buf[1 << BENCH_MAX_BITS];
+        host_core     = 1;
+        auto start    = std::chrono::steady_clock::now();
+        auto period   = std::chrono::nanoseconds((uint64_t)depth * 1000000000 / BENCH_SAMPLE_RATE);
+        uint32_t last = BENCH_LATENCY_FRAMES * DECIMATION_FACTOR;
+        for (uint32_t capture = 1; capture <= last; capture++) {
+            __synth_frame(capture_buf, depth, BENCH_TONE, capture * depth);
+            std::this_thread::sleep_until(start + capture * period);
+            mic_dma_handler(capture_buf);
+            pipeline_step();
+        }
+        producing = false;
+    });
+
+    pitch_result_t result;
+    for (bool done = false; !done;) {
+        done       = !producing.load();
+        bool fresh = false;
+        while (pipeline_pop(&result)) fresh = true;
+        if (!fresh) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        __draw_tuner(buffer, frame++, &state);
+        for (uint64_t until = __now_ns() + BENCH_RENDER_US * 1000; __now_ns() < until;) {}
+        if (ssd1306_begin()) framediff_retract(&diff);
+        ssd1306_trace(result.sequence, result.captured);
+        framediff_flush(&diff, buffer, __send_stream);
+        ssd1306_commit();
+        if (!overlap) ssd1306_wait();
+        done = false; // the last result may still be behind this one
+    }
+    ssd1306_wait();
+    core1.join();
+    host_i2c_device = NULL;
+
+    const profile_stats_t *latency = profile_get(PROFILE_LATENCY);
+    const profile_frames_t *frames = profile_frames();
+    double mean = profile_mean(latency) / 1000.0, p99 = profile_percentile(latency, 99) / 1000.0;
+    double max  = latency->max / 1000.0;
+    fprintf(stderr,
+            "%-9s %-9u %-9u %-9.0f %-9.0f %-9.0f\n",
+            overlap ? "overlap" : "blocking",
+            (unsigned)frames->shown,
+            (unsigned)frames->dropped,
+            mean,
+            p99,
+            max);
+    printf("    {\"display\": \"%s\", \"shown\": %u, \"dropped\": %u, \"mean_us\": %.0f, \"p99_us\": %.0f, "
+           "\"max_us\": %.0f}%s\n",
+           overlap ? "overlap" : "blocking",
+           (unsigned)frames->shown,
+           (unsigned)frames->dropped,
+           mean,
+           p99,
+           max,
+           last ? "" : ",");
+}
+
+/**
+ * @brief Checks the mic capture ring at a few DSP loads
+ *
+ */
+static void __bench_capture() {
+    fprintf(stderr,
+            "\n%-9s %-9s %-9s %-9s %-9s %-9s %-9s\n",
+            "depth",
+            "load",
+            "produced",
+            "consumed",
+            "dropped",
+            "torn",
+            "order");
+    printf("  \"capture\": [\n");
+    uint8_t num_loads = sizeof(CAPTURE_LOADS) / sizeof(CAPTURE_LOADS[0]);
+    for (uint8_t l = 0; l < num_loads; l++) {
+        __run_capture(CAPTURE_RING_DEPTH, CAPTURE_LOADS[l], l == num_loads - 1);
+    }
+    printf("  ],\n");
+}
+
+/**
+ * @brief Runs a capture ring between a thread standing in for the two chained mic DMA
+ *        channels and a consumer standing in for the DSP, and reports what got through
+ * @remarks Each transfer lands a chunk at a time and is stamped with its sequence number,
+ *          so a buffer the consumer holds must read the same number start to end, before
+ *          and after its processing, and the numbers must only go up.
+ *
+ * @param depth buffers in the ring
+ * @param load DSP time per capture, as a share of the capture period
+ * @param last true for the final JSON entry
+ */
+static void __run_capture(uint8_t depth, double load, bool last) {
+    static uint16_t storage[CAPTURE_RING_MAX][BENCH_CAPTURE_SAMPLES];
+    static capture_ring_t ring;
+    uint16_t *buffers[CAPTURE_RING_MAX];
+    for (uint8_t i = 0; i < depth; i++) buffers[i] = storage[i];
+    capture_ring_init(&ring, buffers, depth);
+
+    std::atomic<bool> producing(true);
+    std::atomic<uint32_t> stalls(0);
+    std::thread dma([&producing, &stalls]() {
+        using namespace std::chrono;
+        int8_t slot[2] = {capture_ring_claim(&ring), capture_ring_claim(&ring)};
+        auto next      = steady_clock::now();
+        auto chunk     = nanoseconds(BENCH_CAPTURE_PERIOD * 1000 / BENCH_CAPTURE_CHUNKS);
+        uint8_t active = 0;
+        for (uint32_t capture = 1; capture <= BENCH_CAPTURE_FRAMES; capture++) {
+            uint16_t *buf = ring.buffers[slot[active]];
+            for (uint8_t c = 0; c < BENCH_CAPTURE_CHUNKS; c++) {
+                next += chunk;
+                std::this_thread::sleep_until(next);
+                // The ADC never bunches up, so a host hiccup moves the schedule instead of being caught up
+                if (steady_clock::now() - next > chunk * BENCH_CAPTURE_CHUNKS) next = steady_clock::now();
+                uint16_t per = BENCH_CAPTURE_SAMPLES / BENCH_CAPTURE_CHUNKS;
+                for (uint16_t i = c * per; i < (c + 1) * per; i++) buf[i] = (uint16_t)capture;
+            }
+
+            // What __dma_0_handler() does, the other channel has already started
+            capture_ring_filled(&ring, slot[active], profile_now());
+            slot[active] = capture_ring_claim(&ring);
+            if (slot[active] == CAPTURE_NONE) {
+                stalls++;
+                break;
+            }
+            active ^= 1;
+        }
+        producing = false;
+    });
+
+    uint32_t noise = 777, torn = 0, out_of_order = 0, last_seen = 0;
+    for (bool done = false; !done;) {
+        done        = !producing.load();
+        int8_t slot = capture_ring_acquire(&ring, NULL);
+        if (slot == CAPTURE_NONE) {
+            if (!done) std::this_thread::yield();
+            continue;
+        }
+        done = false; // more may have landed behind this one
+
+        const uint16_t *buf = ring.buffers[slot];
+        uint16_t seen       = buf[0];
+        for (uint16_t i = 1; i < BENCH_CAPTURE_SAMPLES; i++) torn += buf[i] != seen;
+        if (seen <= last_seen) out_of_order++;
+        last_seen = seen;
+
+        // Processing time within 10% either side of the load
+        noise       = noise * 1664525 + 1013904223;
+        double work = load * (0.9 + 0.2 * (noise >> 8) / 16777216.0);
+        std::this_thread::sleep_for(std::chrono::nanoseconds((uint64_t)(work * BENCH_CAPTURE_PERIOD * 1000)));
+        for (uint16_t i = 0; i < BENCH_CAPTURE_SAMPLES; i++) torn += buf[i] != seen;
+        capture_ring_release(&ring, slot);
+    }
+    dma.join();
+
+    uint32_t unaccounted = ring.produced - ring.consumed - ring.dropped - capture_ring_pending(&ring);
+    fprintf(stderr,
+            "%-9u %-9.1f %-9u %-9u %-9u %-9u %-9u %s\n",
+            depth,
+            load,
+            (unsigned)ring.produced,
+            (unsigned)ring.consumed,
+            (unsigned)ring.dropped,
+            torn,
+            out_of_order,
+            unaccounted || stalls ? "(counters out)" : "");
+    printf("    {\"depth\": %u, \"load\": %.1f, \"produced\": %u, \"consumed\": %u, \"dropped\": %u, \"torn\": %u, "
+           "\"out_of_order\": %u, \"unaccounted\": %u, \"stalls\": %u}%s\n",
+           depth,
+           load,
+           (unsigned)ring.produced,
+           (unsigned)ring.consumed,
+           (unsigned)ring.dropped,
+           torn,
+           out_of_order,
+           unaccounted,
+           stalls.load(),
+           last ? "" : ",");
+}
+
+/**
+ * @brief framediff_send_t for the DMA transport
+ */
+static void __send_stream(uint8_t tx, uint8_t ty, uint8_t tw) {
+    ssd1306_tiles(bus_frame, tx, ty, tw);
+}
+
+/**
+ * @brief The panel end of the loopback bus, page addressing only
+ */
+static void __ssd1306_device(uint8_t address, uint8_t byte, bool start) {
+    if (start) {
+        oled_control  = byte;
+        oled_argument = false;
+        return;
+    }
+
+    if (oled_control == 0x40) {
+        if (oled_page == 0 && oled_column == 0) {
+            // Frames a newer one replaced are skipped, but the counter never goes back
+            uint8_t ahead = (byte + 255 - oled_marker) % 255;
+            if (ahead == 0 || ahead > 127) oled_order_errors++;
+            oled_marker = byte;
+        }
+        oled_ram[oled_page * DISPLAY_WIDTH + oled_column] = byte;
+        oled_column                                       = (oled_column + 1) % DISPLAY_WIDTH;
+    } else if (oled_argument) {
+        oled_argument = false; // addressing mode, only page addressing is modelled
+    } else if ((byte & 0xF8) == 0xB0) {
+        oled_page = byte & 0x07;
+    } else if (byte < 0x10) {
+        oled_column = (oled_column & 0xF0) | byte;
+    } else if (byte < 0x20) {
+        oled_column = (oled_column & 0x0F) | ((byte & 0x0F) << 4);
+    } else if (byte == 0x20) {
+        oled_argument = true;
+    }
+}
+
+/**
+ * @brief Draws something shaped like a bar tuner frame into an SSD1306 layout framebuffer
+ * @remarks A bar following a wandering cents value, the note changing every 32 frames and
+ *          the in-tune flash, over the static scale.
+ *
+ * @param buffer framebuffer, DISPLAY_BUFFER_SIZE bytes
+ * @param frame frame number
+ * @param state random state carried between frames
+ */
+static void __draw_tuner(uint8_t *buffer, uint32_t frame, uint32_t *state) {
+    static int8_t cents = 0;
+    static uint8_t note = 0;
+    *state              = *state * 1664525 + 1013904223;
+    cents               = constrain(cents + (int8_t)((*state >> 24) % 7) - 3, -50, 50);
+    if (frame % 32 == 0) note = (*state >> 8) % 12;
+
+    memset(buffer, 0, DISPLAY_BUFFER_SIZE);
+    __draw_background(buffer, BENCH_BAR);
+    __draw_scene(buffer, BENCH_BAR, cents, note);
+}
+
+/**
+ * @brief Draws tuner frames for one visualizer from scratch and from a cached background
+ * @remarks The host has no U8g2, so the screens are stand-ins drawn with the same kind of
+ *          primitives: boxes and lines for the scale, and glyphs plotted a pixel at a time
+ *          the way U8g2 decodes a font. Both frames must come out identical.
+ *
+ * @param visualizer tuner visualizer to draw
+ * @param last true for the final JSON entry
+ */
+static void __bench_layers(bench_visualizer_t visualizer, bool last) {
+    static layer_t layer;
+    static uint8_t full[DISPLAY_BUFFER_SIZE], layered[DISPLAY_BUFFER_SIZE];
+    layer_invalidate(&layer);
+
+    uint32_t state = 4242, mismatches = 0;
+    uint64_t full_ns = 0, layered_ns = 0;
+    int8_t cents = 0;
+    uint8_t note = 0;
+    for (uint32_t f = 0; f < BENCH_LAYER_FRAMES; f++) {
+        state = state * 1664525 + 1013904223;
+        cents = constrain(cents + (int8_t)((state >> 24) % 7) - 3, -50, 50);
+        if (f % 32 == 0) note = (state >> 8) % 12;
+
+        uint64_t start = __now_ns();
+        memset(full, 0, DISPLAY_BUFFER_SIZE);
+        __draw_background(full, visualizer);
+        __draw_scene(full, visualizer, cents, note);
+        full_ns += __now_ns() - start;
+
+        start = __now_ns();
+        if (!layer_restore(&layer, layered, visualizer)) {
+            memset(layered, 0, DISPLAY_BUFFER_SIZE);
+            __draw_background(layered, visualizer);
+            layer_save(&layer, layered, visualizer);
+        }
+        __draw_scene(layered, visualizer, cents, note);
+        layered_ns += __now_ns() - start;
+
+        if (memcmp(full, layered, DISPLAY_BUFFER_SIZE) != 0) mismatches++;
+    }
+
+    double full_frame    = (double)full_ns / BENCH_LAYER_FRAMES;
+    double layered_frame = (double)layered_ns / BENCH_LAYER_FRAMES;
+    fprintf(stderr, "%-9s %-9.0f %-9.0f %-9u\n", VISUALIZER_NAMES[visualizer], full_frame, layered_frame, mismatches);
+    printf("    {\"visualizer\": \"%s\", \"full_ns\": %.0f, \"layered_ns\": %.0f, \"mismatches\": %u}%s\n",
+           VISUALIZER_NAMES[visualizer],
+           full_frame,
+           layered_frame,
+           mismatches,
+           last ? "" : ",");
+}
+
+/**
+ * @brief Draws the static part of a tuner screen, as display.cpp's __tuner_background() does
+ */
+static void __draw_background(uint8_t *buffer, bench_visualizer_t visualizer) {
+    __draw_glyph(buffer, 106, 44, 20, 20); // mode glyph
+
+    if (visualizer == BENCH_TRIANGLE) {
+        __fill_rect(buffer, 63, 3, 2, 26); // center box
+    } else if (visualizer == BENCH_BAR) {
+        __fill_rect(buffer, 63, 8, 2, 16); // center line
+
+        // Endcaps
+        __fill_rect(buffer, 12, 12, 1, 8);
+        __fill_rect(buffer, 12, 20, 4, 1);
+        __fill_rect(buffer, 12, 12, 4, 1);
+        __fill_rect(buffer, 116, 12, 1, 8);
+        __fill_rect(buffer, 113, 20, 4, 1);
+        __fill_rect(buffer, 113, 12, 4, 1);
+
+        // Markers and the double target marker
+        for (int8_t offset : {25, 38, -25, -38}) __fill_rect(buffer, 64 + offset, 16, 1, 4);
+        __fill_rect(buffer, 76, 12, 1, 8);
+        __fill_rect(buffer, 52, 12, 1, 8);
+    }
+}
+
+/**
+ * @brief Draws the moving part of a tuner screen: the visualizer, the note and the center frequency
+ */
+static void __draw_scene(uint8_t *buffer, bench_visualizer_t visualizer, int8_t cents, uint8_t note) {
+    __draw_glyph(buffer, 0, 52, 27, 12); // center frequency
+
+    bool in_tune = abs(cents) < 2;
+    if (visualizer == BENCH_CIRCULAR) {
+        // Needle from the bottom center, plotted along its longer axis
+        double x      = cents / 50.0;
+        uint8_t top   = 50 - 48 * sqrt(1 - x * x);
+        uint8_t steps = std::max(abs(cents), 63 - top);
+        for (uint8_t i = 0; i <= steps; i++) {
+            __fill_rect(buffer, 64 + cents * i / steps, 63 - (63 - top) * i / steps, 1, 1);
+        }
+    } else if (visualizer == BENCH_TRIANGLE && !in_tune) {
+        // Triangle narrowing away from the center box, cut off at the deviation
+        for (int8_t i = 0; i < abs(cents); i++) {
+            uint8_t h = 26 - 26 * i / 60;
+            __fill_rect(buffer, cents > 0 ? 65 + i : 62 - i, 16 - h / 2, 1, h);
+        }
+    } else if (visualizer == BENCH_BAR && !in_tune) {
+        __fill_rect(buffer, cents > 0 ? 65 : 64 + cents, 14, abs(cents), 4);
+    }
+    if (in_tune) __invert_rect(buffer, 2, 2, 126, 30);
+
+    __draw_glyph(buffer, 54 + note, 38, 20, 22); // note name
+}
+
+/**
+ * @brief Plots a stand-in glyph a pixel at a time, background pixels included like an _mf font
+ */
+static void __draw_glyph(uint8_t *buffer, uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
+    for (uint8_t row = y; row < y + h && row < DISPLAY_HEIGHT; row++) {
+        for (uint8_t col = x; col < x + w && col < DISPLAY_WIDTH; col++) {
+            uint8_t *byte = &buffer[(row / 8) * DISPLAY_WIDTH + col];
+            if ((col * 7 + row * 3) % 5 < 3) {
+                *byte |= 1 << (row % 8);
+            } else {
+                *byte &= ~(1 << (row % 8));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Inverts a rectangle, U8g2's draw color 2
+ */
+static void __invert_rect(uint8_t *buffer, uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
+    for (uint8_t row = y; row < y + h && row < DISPLAY_HEIGHT; row++) {
+        for (uint8_t col = x; col < x + w && col < DISPLAY_WIDTH; col++) {
+            buffer[(row / 8) * DISPLAY_WIDTH + col] ^= 1 << (row % 8);
+        }
+    }
+}
+
+/**
+ * @brief Draws note names and numbers by decoding a stand-in font and from the glyph cache
+ * @remarks The stand-in fonts are run-length coded like U8g2's and about the size of inr24
+ *          and inr38. Decoding walks every run a pixel at a time, the way U8g2 plots a glyph.
+ *          Strings are centered and drawn at every baseline over a striped background, so
+ *          the cache's blits are checked at every shift within a page against the decoded
+ *          pixels, background cleared under each glyph box included.
+ */
+static void __bench_glyphs() {
+    static bench_glyph_t decoded[2][GLYPH_COUNT];
+    static glyph_font_t cached[2];
+    static uint8_t expected[DISPLAY_BUFFER_SIZE], actual[DISPLAY_BUFFER_SIZE];
+    const uint8_t sizes[2][3] = {{17, 24, 20}, {27, 38, 31}}; // width, height and advance
+
+    for (uint8_t f = 0; f < 2; f++) {
+        cached[f].height = sizes[f][1];
+        for (uint8_t i = 0; i < GLYPH_COUNT; i++) {
+            __encode_glyph(&decoded[f][i], GLYPH_CHARSET[i], sizes[f][0], sizes[f][1], sizes[f][2]);
+            memset(actual, 0, DISPLAY_BUFFER_SIZE);
+            __decode_glyph(actual, &decoded[f][i], 16, 48);
+            glyph_capture(&cached[f],
+                          GLYPH_CHARSET[i],
+                          actual,
+                          16,
+                          48,
+                          decoded[f][i].advance,
+                          decoded[f][i].dx + decoded[f][i].w);
+        }
+    }
+
+    const char *strings[] = {"Ab", "A", "Bb", "B", "C", "C#", "D", "Eb", "E", "F", "F#", "G", "8", "60", "120", "208"};
+    uint8_t num_strings   = sizeof(strings) / sizeof(strings[0]);
+    uint64_t decoded_ns = 0, cached_ns = 0;
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < BENCH_GLYPH_STRINGS; i++) {
+        const char *str = strings[i % num_strings];
+        uint8_t f       = (i / num_strings) % 2;
+        uint8_t y       = sizes[f][1] + (i / num_strings / 2) % (DISPLAY_HEIGHT - sizes[f][1]);
+        memset(expected, BENCH_GLYPH_FILL, DISPLAY_BUFFER_SIZE);
+        memset(actual, BENCH_GLYPH_FILL, DISPLAY_BUFFER_SIZE);
+
+        uint64_t start = __now_ns();
+        uint8_t x      = 64 - __decoded_width(decoded[f], str) / 2;
+        for (const char *c = str; *c != '\0'; c++) {
+            const bench_glyph_t *glyph = &decoded[f][strchr(GLYPH_CHARSET, *c) - GLYPH_CHARSET];
+            __decode_glyph(expected, glyph, x, y);
+            x += glyph->advance;
+        }
+        decoded_ns += __now_ns() - start;
+
+        start = __now_ns();
+        glyph_draw(actual, &cached[f], 64 - glyph_width(&cached[f], str) / 2, y, str);
+        cached_ns += __now_ns() - start;
+
+        if (memcmp(expected, actual, DISPLAY_BUFFER_SIZE) != 0) mismatches++;
+    }
+
+    double decoded_string = (double)decoded_ns / BENCH_GLYPH_STRINGS;
+    double cached_string  = (double)cached_ns / BENCH_GLYPH_STRINGS;
+    fprintf(stderr,
+            "glyphs: %.0f ns/string decoded, %.0f ns/string cached, %u mismatches, %u bytes cached\n",
+            decoded_string,
+            cached_string,
+            mismatches,
+            (unsigned)sizeof(cached));
+    printf("  \"glyphs\": {\"decoded_ns\": %.0f, \"cached_ns\": %.0f, \"mismatches\": %u, \"cache_bytes\": %u},\n",
+           decoded_string,
+           cached_string,
+           mismatches,
+           (unsigned)sizeof(cached));
+}
+
+/**
+ * @brief Times queueing log records against formatting the message on the spot, then
+ *        drains one core's ring while the other fills it and checks what comes out
+ */
+static void __bench_log() {
+    log_record_t record;
+    uint8_t core = get_core_num();
+    log_drain(); // start from empty rings
+
+    // Each batch fits the ring, popped untimed between batches
+    uint64_t push_ns[3] = {0}, sprintf_ns = 0, filtered_ns = 0;
+    uint32_t filtered = 0;
+    char line[64];
+    float dc = 0.25f, peak = 1234.5f;
+    for (uint32_t i = 0; i < BENCH_LOG_PUSHES; i += LOG_RING_SIZE) {
+        uint64_t start = __now_ns();
+        for (uint8_t j = 0; j < LOG_RING_SIZE; j++) log_push(WARNING, "rolling average: swap buffers");
+        push_ns[0] += __now_ns() - start;
+        while (log_pop(core, &record)) {}
+
+        start = __now_ns();
+        for (uint8_t j = 0; j < LOG_RING_SIZE; j++) log_push(WARNING, "DC: %f, peak: %f", dc, peak + j);
+        push_ns[1] += __now_ns() - start;
+        while (log_pop(core, &record)) {}
+
+        start = __now_ns();
+        for (uint8_t j = 0; j < LOG_RING_SIZE; j++) log_push(WARNING, "%u %u %u %u %u %u", i, j, 1u, 2u, 3u, 4u);
+        push_ns[2] += __now_ns() - start;
+        while (log_pop(core, &record)) {}
+
+        start = __now_ns();
+        for (uint8_t j = 0; j < LOG_RING_SIZE; j++) snprintf(line, sizeof(line), "DC: %f, peak: %f", dc, peak + j);
+        sprintf_ns += __now_ns() - start;
+
+        // Below MSG_LEVEL, nothing should be left of these
+        start = __now_ns();
+        for (uint8_t j = 0; j < LOG_RING_SIZE; j++) LOG_DEBUG("DC: %f, peak: %f", dc, peak + j);
+        filtered_ns += __now_ns() - start;
+        while (log_pop(core, &record)) filtered++;
+    }
+
+    // The other core logs in bursts while this one drains it
+    uint8_t saved_core = host_core;
+    uint32_t popped = 0, order_errors = 0, corrupt = 0, last = 0;
+    uint32_t dropped_before = log_dropped(1);
+    std::thread producer([]() {
+        host_core = 1;
+        for (uint32_t i = 1; i <= BENCH_LOG_RECORDS; i++) {
+            log_push(INFO, "%u %u", i, ~i);
+            if (i % BENCH_LOG_BURST == 0) std::this_thread::yield(); // its real work between messages
+        }
+    });
+    while (true) {
+        bool done = popped + (log_dropped(1) - dropped_before) == BENCH_LOG_RECORDS;
+        if (!log_pop(1, &record)) {
+            if (done) break;
+            std::this_thread::yield();
+            continue;
+        }
+        popped++;
+        if (record.count != 2 || record.core != 1 || record.args[1] != (uint32_t)~record.args[0]) corrupt++;
+        if (record.args[0] <= last) order_errors++;
+        last = record.args[0];
+    }
+    producer.join();
+    host_core        = saved_core;
+    uint32_t dropped = log_dropped(1) - dropped_before;
+    log_drain(); // announces the drops
+
+    // Expansion against printf for the conversions the firmware uses
+    const log_record_t samples[] = {
+        {"FFT set to %d depth (%d bits)", 0, INFO, 0, 2, {4096, 12}},
+        {"%d ADC errors detected out of %d samples", 0, WARNING, 0, 2, {(uintptr_t)(uint32_t)-3, 512}},
+        {"  total       %6u of %u budgeted", 0, INFO, 0, 2, {70144, 90112}},
+        {"%-8s|%5.1f%%|%04x|%c", 0, INFO, 0, 4, {(uintptr_t) "mode", log_word(12.25f), 0xbeef, 'A'}},
+        {"%lu long, %hhu short", 0, INFO, 0, 2, {123456, 7}},
+    };
+    const char *expected[] = {"FFT set to 4096 depth (12 bits)",
+                              "-3 ADC errors detected out of 512 samples",
+                              "  total        70144 of 90112 budgeted",
+                              "mode    | 12.2%|beef|A",
+                              "123456 long, 7 short"};
+    uint8_t mismatches = 0;
+    for (uint8_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        log_format(line, sizeof(line), &samples[i]);
+        if (strcmp(line, expected[i]) != 0) mismatches++;
+    }
+
+    double pushes = BENCH_LOG_PUSHES;
+    fprintf(stderr,
+            "log: %.1f/%.1f/%.1f ns per record with 0/2/6 args, %.1f ns sprintf, %.1f ns filtered (%u queued), "
+            "%u of %u drained across cores (%u dropped, %u out of order, %u corrupt), %u format mismatches\n",
+            push_ns[0] / pushes,
+            push_ns[1] / pushes,
+            push_ns[2] / pushes,
+            sprintf_ns / pushes,
+            filtered_ns / pushes,
+            filtered,
+            popped,
+            BENCH_LOG_RECORDS,
+            dropped,
+            order_errors,
+            corrupt,
+            mismatches);
+    printf("  \"log\": {\"push_ns\": [%.1f, %.1f, %.1f], \"sprintf_ns\": %.1f, \"filtered_ns\": %.1f, "
+           "\"filtered_records\": %u, \"records\": %u, \"drained\": %u, \"dropped\": %u, \"order_errors\": %u, "
+           "\"corrupt\": %u, \"format_mismatches\": %u},\n",
+           push_ns[0] / pushes,
+           push_ns[1] / pushes,
+           push_ns[2] / pushes,
+           sprintf_ns / pushes,
+           filtered_ns / pushes,
+           filtered,
+           BENCH_LOG_RECORDS,
+           popped,
+           dropped,
+           order_errors,
+           corrupt,
+           mismatches);
+}
+
+/**
+ * @brief Checks the profile histograms against exact statistics, times a probe, then
+ *        profiles the default FFT configuration and prints the table the device would
+ */
+static void __bench_profile() {
+    // Spans spread over several powers of 2 with a long tail, like frame times
+    static uint32_t spans[BENCH_PROFILE_SPANS];
+    uint32_t state = 12345;
+    uint64_t sum   = 0;
+    profile_reset();
+    for (uint32_t i = 0; i < BENCH_PROFILE_SPANS; i++) {
+        state      = state * 1664525 + 1013904223;
+        double u   = (state >> 8) / (double)(1 << 24);
+        spans[i]   = 20 + (uint32_t)(-300.0 * log(1.0 - u));
+        sum       += spans[i];
+        profile_record(PROFILE_FREQ2NOTE, spans[i]);
+    }
+    std::sort(spans, spans + BENCH_PROFILE_SPANS);
+    const profile_stats_t *stats = profile_get(PROFILE_FREQ2NOTE);
+    uint32_t exact_p99           = spans[(BENCH_PROFILE_SPANS * 99 + 99) / 100 - 1];
+    uint32_t p99                 = profile_percentile(stats, 99);
+    double p99_error             = (double)p99 / exact_p99 - 1;
+    bool exact = stats->count == BENCH_PROFILE_SPANS && stats->min == spans[0] &&
+                 stats->max == spans[BENCH_PROFILE_SPANS - 1] && stats->sum == sum;
+
+    // A start and stop pair around nothing
+    profile_reset();
+    uint64_t start = __now_ns();
+    for (uint32_t i = 0; i < BENCH_PROFILE_SPANS; i++) {
+        PROFILE_START(probe_start);
+        PROFILE_STOP(PROFILE_FREQ2NOTE, probe_start);
+    }
+    double probe_ns = (double)(__now_ns() - start) / BENCH_PROFILE_SPANS;
+
+    // What the table shows for the default configuration on a steady A4
+    profile_reset();
+    uint64_t elapsed = 0;
+    fix15 freq       = __run_tone(false, BENCH_TONE, &elapsed);
+    for (uint32_t i = 0; i < BENCH_ENGINE_RUNS; i++) {
+        uint8_t index = 0;
+        int8_t cents  = 0;
+        PROFILE_START(note_start);
+        freq2note(freq + i, &index, &cents);
+        PROFILE_STOP(PROFILE_FREQ2NOTE, note_start);
+    }
+
+    fprintf(stderr,
+            "profile: p99 %u against %u exact (%+.1f%%), count, min, max and sum %s, %.1f ns per probe\n",
+            p99,
+            exact_p99,
+            100 * p99_error,
+            exact ? "exact" : "WRONG",
+            probe_ns);
+    profile_dump();
+    printf("  \"profile\": {\"p99\": %u, \"exact_p99\": %u, \"totals_exact\": %s, \"probe_ns\": %.1f, \"probes\": [",
+           p99,
+           exact_p99,
+           exact ? "true" : "false",
+           probe_ns);
+    bool first = true;
+    for (uint8_t p = 0; p < PROFILE_PROBES; p++) {
+        const profile_stats_t *probe = profile_get((profile_probe_t)p);
+        if (probe->count == 0) continue;
+        printf("%s{\"probe\": \"%s\", \"count\": %u, \"mean_ns\": %u, \"p99_ns\": %u, \"max_ns\": %u}",
+               first ? "" : ", ",
+               profile_name((profile_probe_t)p),
+               (unsigned)probe->count,
+               (unsigned)profile_mean(probe),
+               (unsigned)profile_percentile(probe, 99),
+               (unsigned)probe->max);
+        first = false;
+    }
+    printf("]},\n");
+}
+
+/**
+ * @brief Makes up a glyph for a character and run-length codes it
+ */
+static void __encode_glyph(bench_glyph_t *glyph, char c, uint8_t w, uint8_t h, uint8_t advance) {
+    glyph->w       = w;
+    glyph->h       = h;
+    glyph->advance = advance;
+    glyph->dx      = (advance - w) / 2;
+    glyph->dy      = -h;
+    glyph->count   = 0;
+
+    // A frame with a pattern inside that differs per character, runs alternate clear and set
+    bool set    = false;
+    uint8_t run = 0;
+    for (uint16_t p = 0; p < w * h; p++) {
+        uint8_t col = p % w, row = p / w;
+        bool pixel  = col < 3 || row < 3 || col >= w - 3 || row >= h - 3 || (col / 4 + row / 5 + c) % 3 == 0;
+        if (pixel != set || run == 255) {
+            if (glyph->count + 2 >= BENCH_GLYPH_RUNS) { fatal_error("Stand-in glyph has too many runs"); }
+            glyph->runs[glyph->count++] = run;
+            if (pixel == set) glyph->runs[glyph->count++] = 0; // a full run, continue after an empty one
+            set = pixel;
+            run = 0;
+        }
+        run++;
+    }
+    glyph->runs[glyph->count++] = run;
+}
+
+/**
+ * @brief Plots a run-length coded glyph with its origin at x, y, clearing the clear runs like font mode 0
+ */
+static void __decode_glyph(uint8_t *buffer, const bench_glyph_t *glyph, int16_t x, int16_t y) {
+    uint16_t p = 0;
+    for (uint16_t r = 0; r < glyph->count; r++) {
+        for (uint8_t i = 0; i < glyph->runs[r]; i++, p++) {
+            int16_t px = x + glyph->dx + p % glyph->w;
+            int16_t py = y + glyph->dy + p / glyph->w;
+            if (px < 0 || px >= DISPLAY_WIDTH || py < 0 || py >= DISPLAY_HEIGHT) continue;
+            buffer[(py / 8) * DISPLAY_WIDTH + px] &= ~(1 << (py % 8));
+            if (r % 2 == 1) buffer[(py / 8) * DISPLAY_WIDTH + px] |= 1 << (py % 8);
+        }
+    }
+}
+
+/**
+ * @brief getStrWidth() on the stand-in font
+ */
+static uint8_t __decoded_width(bench_glyph_t glyphs[], const char *str) {
+    uint8_t width = 0;
+    for (; *str != '\0'; str++) {
+        const bench_glyph_t *glyph = &glyphs[strchr(GLYPH_CHARSET, *str) - GLYPH_CHARSET];
+        width += (str[1] == '\0') ? glyph->dx + glyph->w : glyph->advance;
+    }
+    return width;
+}
+
+/**
+ * @brief framediff_send_t that only counts transfers
+ */
+static void __count_tiles(uint8_t tx, uint8_t ty, uint8_t tw) {
+    tile_runs++;
+}
+
+/**
+ * @brief Sets a rectangle of pixels in an SSD1306 layout framebuffer
+ */
+static void __fill_rect(uint8_t *buffer, uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
+    for (uint8_t row = y; row < y + h && row < DISPLAY_HEIGHT; row++) {
+        for (uint8_t col = x; col < x + w && col < DISPLAY_WIDTH; col++) {
+            buffer[(row / 8) * DISPLAY_WIDTH + col] |= 1 << (row % 8);
+        }
+    }
+}
+
+/**
+ * @brief Runs the core1 pipeline on a second thread and drains it from this one, like core0 would
+ * @remarks Checks that results arrive in order and that every sequence gap is a counted drop.
+ *          The consumer switches pitch engine halfway through to exercise the settings path.
+ */
+static void __bench_pipeline() {
+    uint16_t bits  = 12;
+    uint16_t depth = 1 << bits;
+
+    fft_init(bits, BENCH_SAMPLE_RATE);
+    fft_set_decimation(DECIMATION_FACTOR);
+    pipeline_set_engine(ENGINE_FFT);
+    pipeline_set_center(440);
+    pipeline_init();
+
+    std::atomic<bool> producing(true);
+    uint64_t start = __now_ns();
+    std::thread core1([depth, &producing]() {
+        static uint16_t capture_buf[1 << BENCH_MAX_BITS];
+        uint32_t capture = 0;
+        for (uint32_t f = 0; f < BENCH_PIPE_FRAMES; f++) {
+            for (uint8_t d = 0; d < DECIMATION_FACTOR; d++) {
+                __synth_frame(capture_buf, depth, BENCH_TONE, capture++ * depth);
+                mic_dma_handler(capture_buf);
+                pipeline_step();
+            }
+        }
+        producing = false;
+    });
+
+    pitch_result_t result;
+    uint32_t received = 0, out_of_order = 0, gaps = 0;
+    uint32_t next_sequence = 0;
+    uint64_t latency_us    = 0;
+    for (bool done = false; !done;) {
+        // Sample the flag first so nothing published before it went false is missed
+        done = !producing.load();
+        while (pipeline_pop(&result)) {
+            if (result.sequence < next_sequence) out_of_order++;
+            if (result.sequence > next_sequence) gaps += result.sequence - next_sequence;
+            next_sequence = result.sequence + 1;
+            latency_us += (uint32_t)micros() - result.timestamp; // the device clock is 32 bits too
+            if (++received == BENCH_PIPE_FRAMES / 2) pipeline_set_engine(ENGINE_YIN);
+        }
+        std::this_thread::yield();
+    }
+    uint64_t elapse = __now_ns() - start;
+    core1.join();
+
+    fprintf(stderr,
+            "\npipeline: %u results, %u dropped, %u gaps, %u out of order, %.0f results/s, %.1f us queue latency\n",
+            received,
+            pipeline_dropped(),
+            gaps,
+            out_of_order,
+            received * 1e9 / elapse,
+            received ? (double)latency_us / received : 0.0);
+    printf("  \"pipeline\": {\"results\": %u, \"dropped\": %u, \"gaps\": %u, \"out_of_order\": %u, "
+           "\"results_per_s\": %.0f},\n",
+           received,
+           pipeline_dropped(),
+           gaps,
+           out_of_order,
+           received * 1e9 / elapse);
+}
+
+/**
+ * @brief Monotonic host clock
+ *
+ * @return uint64_t nanoseconds
+ */
+static uint64_t __now_ns() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Fills a buffer with what the ADC would see for a plucked string: a tone,
+ *        two harmonics and a little noise, biased to the middle of the 12-bit range
+ *
+ * @param buf output buffer
+ * @param depth number of samples
+ * @param freq fundamental in Hz
+ * @param offset index of the first sample, keeps phase continuous across frames
+ */
+static void __synth_frame(uint16_t *buf, uint16_t depth, double freq, uint32_t offset) {
+    for (uint16_t i = 0; i < depth; i++) {
+        double t     = (double)(offset + i) / BENCH_SAMPLE_RATE;
+        double value = sin(2 * M_PI * freq * t) + 0.5 * sin(4 * M_PI * freq * t) + 0.25 * sin(6 * M_PI * freq * t);
+
+        noise_state  = noise_state * 1664525 + 1013904223;
+        int noise    = (int)(noise_state >> 28) - 8;
+
+        buf[i]       = (uint16_t)(2048 + BENCH_AMPLITUDE * value / 1.75 + noise);
+    }
+}
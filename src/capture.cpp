@@ -0,0 +1,111 @@
+#include "capture.h"
+
+/**
+ * @brief Hands a set of buffers to the ring, all free
+ *
+ * @param ring ring to set up
+ * @param buffers capture buffers, each as long as a DMA transfer
+ * @param depth number of buffers, CAPTURE_RING_MIN or more: two for the DMA, one held by the
+ *              DSP and a spare, without which every capture finishing while the DSP holds
+ *              a buffer would be dropped
+ */
+void capture_ring_init(capture_ring_t *ring, uint16_t *buffers[], uint8_t depth) {
+    if (depth < CAPTURE_RING_MIN || depth > CAPTURE_RING_MAX) { fatal_error("Capture ring depth out of range"); }
+
+    memset(ring, 0, sizeof(*ring));
+    ring->depth = depth;
+    for (uint8_t i = 0; i < depth; i++) {
+        ring->buffers[i] = buffers[i];
+        ring->state[i]   = CAPTURE_FREE;
+    }
+}
+
+/**
+ * @brief Takes a buffer for the DMA to fill next
+ * @remarks A free one if there is one. Otherwise the DSP is behind, so the oldest ready
+ *          buffer is taken back and counted as dropped; the newest samples are worth more.
+ *
+ * @param ring ring to take from
+ * @return int8_t slot now filling, CAPTURE_NONE if every buffer is filling or held
+ */
+int8_t capture_ring_claim(capture_ring_t *ring) {
+    uint32_t status = save_and_disable_interrupts();
+    int8_t slot     = CAPTURE_NONE;
+    for (uint8_t i = 0; i < ring->depth && slot == CAPTURE_NONE; i++) {
+        if (ring->state[i] == CAPTURE_FREE) slot = i;
+    }
+    if (slot == CAPTURE_NONE) {
+        for (uint8_t i = 0; i < ring->depth; i++) {
+            if (ring->state[i] != CAPTURE_READY) continue;
+            if (slot == CAPTURE_NONE || (int32_t)(ring->order[i] - ring->order[slot]) < 0) slot = i;
+        }
+        if (slot != CAPTURE_NONE) ring->dropped = ring->dropped + 1;
+    }
+    if (slot != CAPTURE_NONE) ring->state[slot] = CAPTURE_FILLING;
+    restore_interrupts(status);
+    return slot;
+}
+
+/**
+ * @brief Passes a buffer the DMA has finished to the DSP
+ *
+ * @param ring ring it belongs to
+ * @param slot slot from capture_ring_claim()
+ * @param stamp when it finished, see profile_now()
+ */
+void capture_ring_filled(capture_ring_t *ring, int8_t slot, uint32_t stamp) {
+    uint32_t status   = save_and_disable_interrupts();
+    ring->order[slot] = ring->produced;
+    ring->stamp[slot] = stamp;
+    ring->produced    = ring->produced + 1;
+    ring->state[slot] = CAPTURE_READY;
+    restore_interrupts(status);
+}
+
+/**
+ * @brief Takes the oldest filled buffer for the DSP, which owns it until it's released
+ *
+ * @param ring ring to take from
+ * @param stamp set to when it was filled, can be NULL
+ * @return int8_t slot now held, CAPTURE_NONE if nothing is ready
+ */
+int8_t capture_ring_acquire(capture_ring_t *ring, uint32_t *stamp) {
+    uint32_t status = save_and_disable_interrupts();
+    int8_t slot     = CAPTURE_NONE;
+    for (uint8_t i = 0; i < ring->depth; i++) {
+        if (ring->state[i] != CAPTURE_READY) continue;
+        if (slot == CAPTURE_NONE || (int32_t)(ring->order[i] - ring->order[slot]) < 0) slot = i;
+    }
+    if (slot != CAPTURE_NONE) {
+        ring->state[slot] = CAPTURE_HELD;
+        if (stamp != NULL) *stamp = ring->stamp[slot];
+    }
+    restore_interrupts(status);
+    return slot;
+}
+
+/**
+ * @brief Gives a buffer back for the DMA to fill again
+ *
+ * @param ring ring it belongs to
+ * @param slot slot from capture_ring_acquire(), CAPTURE_NONE is ignored
+ */
+void capture_ring_release(capture_ring_t *ring, int8_t slot) {
+    if (slot == CAPTURE_NONE) return;
+    uint32_t status   = save_and_disable_interrupts();
+    ring->state[slot] = CAPTURE_FREE;
+    ring->consumed    = ring->consumed + 1;
+    restore_interrupts(status);
+}
+
+/**
+ * @brief Buffers filled and waiting for the DSP
+ *
+ * @param ring ring to check
+ * @return uint8_t ready buffers
+ */
+uint8_t capture_ring_pending(const capture_ring_t *ring) {
+    uint8_t pending = 0;
+    for (uint8_t i = 0; i < ring->depth; i++) pending += ring->state[i] == CAPTURE_READY;
+    return pending;
+}
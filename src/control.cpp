@@ -40,12 +40,12 @@ bool __control_poll(struct repeating_timer *t) {
     // Check on buttons (change state on release)
     if (last_state.mode_but_state == 1 && cur_state.mode_but_state == 0) {
         output_target->mode_but_pressed++;
-        print_msg("control: mode_but pressed", DEBUG);
+        LOG_DEBUG("control: mode_but pressed");
     }
 
     if (last_state.encoder_but_state == 1 && cur_state.encoder_but_state == 0) {
         output_target->encoder_but_pressed++;
-        print_msg("control: encoder_but pressed", DEBUG);
+        LOG_DEBUG("control: encoder_but pressed");
     }
 
     // Check on encoders
@@ -55,7 +55,7 @@ bool __control_poll(struct repeating_timer *t) {
         } else {
             output_target->encoder_movement++;
         }
-        print_msg("control: encoder state change detected", DEBUG);
+        LOG_DEBUG("control: encoder state change detected");
     }
     return true;
 }
@@ -0,0 +1,90 @@
+#include "decimate.h"
+
+// Global variables
+int16_t decimation_taps[DECIMATION_MAX_TAPS]      = {0};
+int16_t decimation_delay[2 * DECIMATION_MAX_TAPS] = {0};
+uint16_t decimation_num_taps                      = 0;
+uint16_t decimation_pos                           = 0;
+uint8_t decimation_factor                         = 1;
+uint8_t decimation_phase                          = 0;
+
+/**
+ * @brief Designs the anti-alias filter and resets the decimator state
+ * @remarks Hamming windowed sinc with DECIMATION_TAPS_PER_PHASE taps per output phase,
+ *          so the cost per input sample stays the same whatever the factor is
+ *
+ * @param factor input samples per output sample
+ */
+void decimate_init(uint8_t factor) {
+    if (factor < 1 || factor > DECIMATION_MAX_FACTOR) { fatal_error("Invalid decimation factor"); }
+
+    decimation_factor   = factor;
+    decimation_num_taps = factor * DECIMATION_TAPS_PER_PHASE;
+    decimation_phase    = 0;
+    decimation_pos      = 0;
+    memset(decimation_delay, 0, sizeof(decimation_delay));
+
+    // Cutoff in cycles/sample at the input rate
+    double cutoff = DECIMATION_CUTOFF * 0.5 / factor;
+    double center = (decimation_num_taps - 1) / 2.0;
+    double taps[DECIMATION_MAX_TAPS];
+    double sum = 0;
+    for (uint16_t t = 0; t < decimation_num_taps; t++) {
+        double x    = t - center;
+        double sinc = (x == 0) ? 2 * cutoff : sin(2 * M_PI * cutoff * x) / (M_PI * x);
+        taps[t]     = sinc * (0.54 - 0.46 * cos(2 * M_PI * t / (decimation_num_taps - 1)));
+        sum += taps[t];
+    }
+
+    // Normalize to unity gain at DC
+    for (uint16_t t = 0; t < decimation_num_taps; t++) {
+        decimation_taps[t] = (int16_t)round(taps[t] / sum * 32768);
+    }
+}
+
+/**
+ * @brief Low-pass filters and downsamples a block of raw ADC samples
+ * @note Filter state carries over between calls, so consecutive captures are treated
+ *       as one continuous stream
+ *
+ * @param input raw ADC samples, bit 15 is the ADC error flag
+ * @param in_len number of input samples
+ * @param output decimated 12-bit samples
+ * @param out_max room left in output, any further samples are dropped
+ * @param errors incremented for each input sample with the error flag set
+ * @return uint16_t number of samples written to output
+ */
+uint16_t decimate(const uint16_t *input, uint16_t in_len, uint16_t *output, uint16_t out_max, uint16_t *errors) {
+    uint16_t written = 0;
+
+    for (uint16_t i = 0; i < in_len; i++) {
+        uint16_t raw = input[i];
+        if (raw & 0x8000) {
+            (*errors)++;
+            raw &= 0x7FFF;
+        }
+
+        // Each sample is stored twice so the newest num_taps samples are always contiguous
+        if (decimation_pos == 0) decimation_pos = decimation_num_taps;
+        decimation_pos--;
+        int16_t centered                                       = (int16_t)raw - ADC_MIDSCALE;
+        decimation_delay[decimation_pos]                       = centered;
+        decimation_delay[decimation_pos + decimation_num_taps] = centered;
+
+        // Only every factor'th filter output is ever needed, so only those are computed
+        if (++decimation_phase < decimation_factor) continue;
+        decimation_phase = 0;
+
+        int32_t acc          = 0;
+        const int16_t *delay = &decimation_delay[decimation_pos];
+        for (uint16_t t = 0; t < decimation_num_taps; t++) {
+            acc += (int32_t)decimation_taps[t] * delay[t];
+        }
+
+        if (written >= out_max) continue;
+        int32_t sample    = (acc >> 15) + ADC_MIDSCALE;
+        output[written++] = (uint16_t)constrain(sample, 0, 4095);
+    }
+
+    return written;
+}
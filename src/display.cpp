@@ -1,13 +1,68 @@
 #include "display.h"
 
+#include "tables.h"
+
 // Private prototypes
-const void __note2char(display_note_t note, char *output);
+typedef void (*background_t)(struct display_tuner_t *tuner);
+enum text_font_t { TEXT_INR24, TEXT_INR38, TEXT_FONTS };
+
+static const char *__note_name(display_note_t note);
+static void __cache_glyphs(text_font_t font);
+static uint8_t __text_width(text_font_t font, const char *str);
+static uint8_t __text_height(text_font_t font);
+static uint8_t __note_half_width(text_font_t font, display_note_t note);
+static void __draw_text(text_font_t font, uint8_t x, uint8_t y, const char *str);
+static void __tuner_background(struct display_tuner_t *tuner);
+static void __metronome_background(struct display_tuner_t *tuner);
+static void __soundback_background(struct display_tuner_t *tuner);
+static void __frame_begin(profile_probe_t probe,
+                          layer_t *layer,
+                          uint16_t key,
+                          background_t background,
+                          struct display_tuner_t *tuner);
+static void __frame_end(const struct display_tuner_t *traced);
+static void __send_tiles(uint8_t tx, uint8_t ty, uint8_t tw);
 
 // Global variables
 U8G2_SSD1306_128X64_NONAME_F_HW_I2C display(U8G2_R0);
+framediff_t display_diff;
+display_stats_t display_counters = {0};
+uint32_t frame_start             = 0;
+profile_probe_t frame_probe      = PROFILE_PROBES; // screen being drawn, for the profile
+uint32_t frame_ticks             = 0;
+layer_t tuner_layer, metronome_layer, soundback_layer;
+glyph_font_t text_glyphs[TEXT_FONTS];
+uint8_t note_half_widths[TEXT_FONTS][NOTE_NONE + 1]; // centering offsets for every note name
+
+const char *NOTE_NAMES[NOTE_NONE + 1] = {"Ab", "A", "Bb", "B", "C", "C#", "D", "Eb", "E", "F", "F#", "G", ""};
+const uint8_t *TEXT_FONTS_U8G2[TEXT_FONTS] = {u8g2_font_inr24_mf, u8g2_font_inr38_mf};
+
+#if defined(CIRCULAR_TUNER)
+#define DISPLAY_VISUALIZER "circular"
+#elif defined(TRIANGLE_TUNER)
+#define DISPLAY_VISUALIZER "triangle"
+#else
+#define DISPLAY_VISUALIZER "bar"
+#endif
+#ifdef DISPLAY_LAYERS
+#define DISPLAY_LAYER_STATE "on"
+#else
+#define DISPLAY_LAYER_STATE "off"
+#endif
 
 #ifdef CIRCULAR_TUNER
-uint8_t DEVIATION_LUT[101];
+// Needle end height for each cents deviation, a circle of the needle's length
+struct deviation_table {
+    uint8_t values[2 * DEVIATION_WIDTH + 1];
+
+    constexpr deviation_table() : values() {
+        for (int i = -DEVIATION_WIDTH; i <= DEVIATION_WIDTH; i++) {
+            double x                    = double(i) / DEVIATION_WIDTH;
+            values[i + DEVIATION_WIDTH] = DEVIATION_BOTTOM - DEVIATION_HEIGHT * __ce_sqrt(1 - x * x);
+        }
+    }
+};
+constexpr deviation_table DEVIATION_LUT;
 #endif
 
 /**
@@ -21,8 +76,17 @@ void display_init() {
 
     if (!display.begin()) { fatal_error("Failed to initialize display"); }
     display.enableUTF8Print();
+#ifdef DISPLAY_DMA
+    // U8g2 has set the panel up over Wire, the DMA transport takes the bus from here
+    ssd1306_init(i2c0, DISPLAY_ADDRESS);
+#endif
+    display_invalidate();
 
-    display.clearBuffer();
+#ifdef DISPLAY_GLYPHS
+    for (uint8_t font = 0; font < TEXT_FONTS; font++) { __cache_glyphs((text_font_t)font); }
+#endif
+
+    __frame_begin(PROFILE_PROBES, NULL, 0, NULL, NULL);
     display.setFont(u8g2_font_inr24_mf);
 
     // Draw a splash screen
@@ -34,14 +98,7 @@ void display_init() {
     display.setFont(u8g2_font_fur11_tr);
     display.drawStr(24, 58, "Initializing...");
 
-    display.sendBuffer();
-
-#ifdef CIRCULAR_TUNER
-    // Generate LUT for the tuner
-    for (int8_t i = -50; i <= 50; i++) {
-        DEVIATION_LUT[i + 50] = DEVIATION_BOTTOM - DEVIATION_HEIGHT * sqrt(1 - pow((float(i) / DEVIATION_WIDTH), 2));
-    }
-#endif
+    __frame_end(NULL);
 
     return;
 }
@@ -53,7 +110,7 @@ void display_init() {
  * @note Multiple options available with #define [CIRCULAR_TUNER, TRIANGLE_TUNER, BAR_TUNER]
  */
 void display_tuner(struct display_tuner_t *tuner) {
-    display.clearBuffer();
+    __frame_begin(PROFILE_DISPLAY_TUNER, &tuner_layer, tuner->display_meme, __tuner_background, tuner);
 
     if (!(tuner->display_meme)) {
         // Draw center frequency
@@ -81,15 +138,6 @@ void display_tuner(struct display_tuner_t *tuner) {
         display.drawStr(0, 63, cents_sharp);
     }
 
-    // Draw tuner glyph
-    if (tuner->display_meme) {
-        display.setFont(u8g2_font_streamline_money_payments_t);
-        display.drawStr(106, 64, "\x38");
-    } else {
-        display.setFont(u8g2_font_streamline_music_audio_t);
-        display.drawStr(106, 64, "\x31");
-    }
-
     // if (tuner->low_noise) {
     //     display.setFont(u8g2_font_streamline_users_t);
     //     display.drawStr(54, 10, "\x3a");
@@ -99,17 +147,9 @@ void display_tuner(struct display_tuner_t *tuner) {
     // Draw the tuner visualizer
 #ifdef CIRCULAR_TUNER
     // We are given the percent deviation, so we can back-calculate the angle using math
-    display.drawLine(64, 64, (tuner->cents_deviation) + 64, DEVIATION_LUT[tuner->cents_deviation + 50]);
+    display.drawLine(64, 64, (tuner->cents_deviation) + 64, DEVIATION_LUT.values[tuner->cents_deviation + 50]);
 #endif
 #ifdef TRIANGLE_TUNER
-    // Draw center box
-
-    display.setDrawColor(1);
-    display.drawBox(display.getWidth() / 2 - TRIANGLE_CENTER_OFFSET,
-                    TRIANGLE_CENTER_VERT_CENT - TRIANGLE_CENTER_HEIGHT / 2,
-                    TRIANGLE_CENTER_OFFSET * 2,
-                    TRIANGLE_CENTER_HEIGHT);
-
     // Draw triangle according to sharp/flat
     if (tuner->cents_deviation > -INTUNE_TOLERANCE && tuner->cents_deviation < INTUNE_TOLERANCE) {
         // perfectly in tune, nice
@@ -148,45 +188,6 @@ void display_tuner(struct display_tuner_t *tuner) {
 
 #endif
 #ifdef BAR_TUNER
-    // Draw center line
-    display.setDrawColor(1);
-    display.drawBox(display.getWidth() / 2 - BAR_CENTER_WIDTH / 2,
-                    BAR_CENTER_YPOS - BAR_CENTER_HEIGHT / 2,
-                    BAR_CENTER_WIDTH,
-                    BAR_CENTER_HEIGHT);
-
-    // Draw left endcap
-    display.drawVLine(display.getWidth() / 2 - 50 - BAR_ENDCAP_HOFFSET,
-                      BAR_CENTER_YPOS - BAR_ENDCAP_HEIGHT / 2,
-                      BAR_ENDCAP_HEIGHT);
-    display.drawHLine(display.getWidth() / 2 - 50 - BAR_ENDCAP_HOFFSET,
-                      BAR_CENTER_YPOS + BAR_ENDCAP_HEIGHT / 2,
-                      BAR_ENDCAP_TIPLEN);
-    display.drawHLine(display.getWidth() / 2 - 50 - BAR_ENDCAP_HOFFSET,
-                      BAR_CENTER_YPOS - BAR_ENDCAP_HEIGHT / 2,
-                      BAR_ENDCAP_TIPLEN);
-
-    // Draw right endcap
-    display.drawVLine(display.getWidth() / 2 + 50 + BAR_ENDCAP_HOFFSET,
-                      BAR_CENTER_YPOS - BAR_ENDCAP_HEIGHT / 2,
-                      BAR_ENDCAP_HEIGHT);
-    display.drawHLine(display.getWidth() / 2 + 50 + BAR_ENDCAP_HOFFSET - BAR_ENDCAP_TIPLEN + 1,
-                      BAR_CENTER_YPOS + BAR_ENDCAP_HEIGHT / 2,
-                      BAR_ENDCAP_TIPLEN);
-    display.drawHLine(display.getWidth() / 2 + 50 + BAR_ENDCAP_HOFFSET - BAR_ENDCAP_TIPLEN + 1,
-                      BAR_CENTER_YPOS - BAR_ENDCAP_HEIGHT / 2,
-                      BAR_ENDCAP_TIPLEN);
-
-    // Draw markers (25%, 38%)
-    display.drawVLine(display.getWidth() / 2 + 25, BAR_CENTER_YPOS, BAR_MARKER_LEN);
-    display.drawVLine(display.getWidth() / 2 + 38, BAR_CENTER_YPOS, BAR_MARKER_LEN);
-    display.drawVLine(display.getWidth() / 2 - 25, BAR_CENTER_YPOS, BAR_MARKER_LEN);
-    display.drawVLine(display.getWidth() / 2 - 38, BAR_CENTER_YPOS, BAR_MARKER_LEN);
-
-    // Draw double target marker
-    display.drawVLine(display.getWidth() / 2 + 12, BAR_CENTER_YPOS - BAR_MARKER_LEN, BAR_MARKER_LEN * 2);
-    display.drawVLine(display.getWidth() / 2 - 12, BAR_CENTER_YPOS - BAR_MARKER_LEN, BAR_MARKER_LEN * 2);
-
     // Draw the tuning line
     if (tuner->cents_deviation > -INTUNE_TOLERANCE && tuner->cents_deviation < INTUNE_TOLERANCE) {
         // perfectly in tune, nice
@@ -209,32 +210,12 @@ void display_tuner(struct display_tuner_t *tuner) {
 #endif
 
     // Draw the note
-    char note[3] = "";
-    __note2char(tuner->current_note, note);
-
-    display.setFont(u8g2_font_inr24_mf);
-    uint8_t w = display.getStrWidth(note);
-    uint8_t h = display.getAscent() - display.getDescent();
-    uint8_t x = 64 - w / 2;
-    if (tuner->display_meme) { x = 64 - w / 2 + 16; }
+    // TODO: make a nice flat/sharp glyph
+    uint8_t x = 64 - __note_half_width(TEXT_INR24, tuner->current_note);
+    if (tuner->display_meme) { x += 16; }
     uint8_t y = 64 - 4;
-
-    if (strlen(note) == 0) {
-        // Do nothing, no note
-    } else if (strlen(note) == 2) {
-        // TODO: make a nice flat/sharp glyph
-        if (note[1] == '#') {
-            // draw sharp
-            display.drawStr(x, y, note);
-        } else {
-            // draw flat
-            display.drawStr(x, y, note);
-        }
-    } else {
-        // No sharp/flat
-        display.drawStr(x, y, note);
-    }
-    display.sendBuffer();
+    __draw_text(TEXT_INR24, x, y, __note_name(tuner->current_note));
+    __frame_end(tuner);
 }
 
 /**
@@ -243,21 +224,14 @@ void display_tuner(struct display_tuner_t *tuner) {
  * @param tuner parameters for metronome
  */
 void display_metronome(struct display_tuner_t *tuner) {
-    display.clearBuffer();
+    __frame_begin(PROFILE_DISPLAY_METRONOME, &metronome_layer, 0, __metronome_background, tuner);
 
     // Draw current BPM
     char cur_bpm[8];
     sprintf(cur_bpm, "%d", tuner->metronome_bpm);
-    display.setFont(u8g2_font_inr38_mf);
-    uint8_t w = display.getStrWidth(cur_bpm);
-    uint8_t h = display.getAscent() - display.getDescent();
-    uint8_t x = 64 - w / 2;
-    uint8_t y = h - 6;
-    display.drawStr(x, y, cur_bpm);
-
-    // Draw metronome glyph
-    display.setFont(u8g2_font_streamline_interface_essential_alert_t);
-    display.drawStr(106, 64, "\x34");
+    uint8_t x = 64 - __text_width(TEXT_INR38, cur_bpm) / 2;
+    uint8_t y = __text_height(TEXT_INR38) - 6;
+    __draw_text(TEXT_INR38, x, y, cur_bpm);
 
     // Draw disable glyph
     if (tuner->soundback_en) {
@@ -309,50 +283,24 @@ void display_metronome(struct display_tuner_t *tuner) {
         display.setCursor(1, 63);
         display.print("\x3F\x3F");
     }
-    display.sendBuffer();
+    __frame_end(NULL);
 }
 
 void display_soundback(struct display_tuner_t *tuner) {
-    display.clearBuffer();
+    __frame_begin(PROFILE_DISPLAY_SOUNDBACK, &soundback_layer, 0, __soundback_background, tuner);
 
     // Draw target note
-    char note[3] = "";
-    __note2char(tuner->soundback_note, note);
-
-    display.setFont(u8g2_font_inr38_mf);
-    uint8_t w = display.getStrWidth(note);
-    uint8_t h = display.getAscent() - display.getDescent();
-    uint8_t x = 64 - w / 2;
-    uint8_t y = h - 6;
-
-    if (strlen(note) == 2) {
-        // TODO: make a nice flat/sharp glyph
-        if (note[1] == '#') {
-            // draw sharp
-            display.drawStr(x, y, note);
-        } else {
-            // draw flat
-            display.drawStr(x, y, note);
-        }
-    } else {
-        // No sharp/flat
-        display.drawStr(x, y, note);
-    }
+    // TODO: make a nice flat/sharp glyph
+    uint8_t x = 64 - __note_half_width(TEXT_INR38, tuner->soundback_note);
+    uint8_t y = __text_height(TEXT_INR38) - 6;
+    __draw_text(TEXT_INR38, x, y, __note_name(tuner->soundback_note));
 
     // Draw target octave
-    sprintf(note, "%d", tuner->soundback_octave);
-    display.setFont(u8g2_font_inr24_mf);
-
-    w = display.getStrWidth(note);
-    h = display.getAscent() - display.getDescent();
-    x = display.getWidth() - w - 4;
-    y = h - 4;
-
-    display.drawStr(x, y, note);
-
-    // Draw soundback glyph
-    display.setFont(u8g2_font_streamline_interface_essential_audio_t);
-    display.drawStr(106, 64, "\x33");
+    char octave[4];
+    sprintf(octave, "%d", tuner->soundback_octave);
+    x = display.getWidth() - __text_width(TEXT_INR24, octave) - 4;
+    y = __text_height(TEXT_INR24) - 4;
+    __draw_text(TEXT_INR24, x, y, octave);
 
     // Draw play/pause
     display.setFont(u8g2_font_unifont_t_symbols);
@@ -371,57 +319,317 @@ void display_soundback(struct display_tuner_t *tuner) {
         display.setFontMode(0);
     }
 
-    display.sendBuffer();
+    __frame_end(NULL);
+}
+
+/**
+ * @brief Makes the next frame a full refresh, e.g. after the panel was reset
+ *
+ */
+void display_invalidate() {
+    framediff_invalidate(&display_diff);
+}
+
+/**
+ * @brief Transfer counters since display_init()
+ *
+ * @return const display_stats_t* counters, updated after every frame
+ */
+const display_stats_t *display_stats() {
+    return &display_counters;
+}
+
+/**
+ * @brief Logs bytes sent and time spent per frame
+ *
+ */
+void display_report() {
+    if (display_counters.frames == 0) return;
+    LOG_DEBUG("display: %u frames, %u bytes/frame (last %u), %u us/frame (last %u, max %u)",
+              (unsigned)display_counters.frames,
+              (unsigned)(display_counters.bytes / display_counters.frames),
+              (unsigned)display_counters.last_bytes,
+              (unsigned)(display_counters.total_us / display_counters.frames),
+              (unsigned)display_counters.last_us,
+              (unsigned)display_counters.max_us);
+    LOG_DEBUG("display: %u us/frame drawing (last %u), " DISPLAY_VISUALIZER " tuner, layers " DISPLAY_LAYER_STATE,
+              (unsigned)(display_counters.render_us / display_counters.frames),
+              (unsigned)display_counters.last_render_us);
+#ifdef DISPLAY_DMA
+    const ssd1306_stats_t *bus = ssd1306_stats();
+    LOG_DEBUG("display: %u bytes on the bus, %u waits for a stream (%u us), %u timeouts",
+              (unsigned)bus->words,
+              (unsigned)bus->waits,
+              (unsigned)bus->wait_us,
+              (unsigned)bus->timeouts);
+#endif
 }
 
 /**
- * @brief Converts a enum note into a char array
+ * @brief Draws what doesn't move on the tuner screen: the mode glyph and the visualizer's scale
+ *
+ * @param tuner parameters for the tuner, only display_meme changes the background
+ */
+static void __tuner_background(struct display_tuner_t *tuner) {
+    // Draw tuner glyph
+    if (tuner->display_meme) {
+        display.setFont(u8g2_font_streamline_money_payments_t);
+        display.drawStr(106, 64, "\x38");
+    } else {
+        display.setFont(u8g2_font_streamline_music_audio_t);
+        display.drawStr(106, 64, "\x31");
+    }
+
+#ifdef TRIANGLE_TUNER
+    // Draw center box
+    display.setDrawColor(1);
+    display.drawBox(display.getWidth() / 2 - TRIANGLE_CENTER_OFFSET,
+                    TRIANGLE_CENTER_VERT_CENT - TRIANGLE_CENTER_HEIGHT / 2,
+                    TRIANGLE_CENTER_OFFSET * 2,
+                    TRIANGLE_CENTER_HEIGHT);
+#endif
+#ifdef BAR_TUNER
+    // Draw center line
+    display.setDrawColor(1);
+    display.drawBox(display.getWidth() / 2 - BAR_CENTER_WIDTH / 2,
+                    BAR_CENTER_YPOS - BAR_CENTER_HEIGHT / 2,
+                    BAR_CENTER_WIDTH,
+                    BAR_CENTER_HEIGHT);
+
+    // Draw left endcap
+    display.drawVLine(display.getWidth() / 2 - 50 - BAR_ENDCAP_HOFFSET,
+                      BAR_CENTER_YPOS - BAR_ENDCAP_HEIGHT / 2,
+                      BAR_ENDCAP_HEIGHT);
+    display.drawHLine(display.getWidth() / 2 - 50 - BAR_ENDCAP_HOFFSET,
+                      BAR_CENTER_YPOS + BAR_ENDCAP_HEIGHT / 2,
+                      BAR_ENDCAP_TIPLEN);
+    display.drawHLine(display.getWidth() / 2 - 50 - BAR_ENDCAP_HOFFSET,
+                      BAR_CENTER_YPOS - BAR_ENDCAP_HEIGHT / 2,
+                      BAR_ENDCAP_TIPLEN);
+
+    // Draw right endcap
+    display.drawVLine(display.getWidth() / 2 + 50 + BAR_ENDCAP_HOFFSET,
+                      BAR_CENTER_YPOS - BAR_ENDCAP_HEIGHT / 2,
+                      BAR_ENDCAP_HEIGHT);
+    display.drawHLine(display.getWidth() / 2 + 50 + BAR_ENDCAP_HOFFSET - BAR_ENDCAP_TIPLEN + 1,
+                      BAR_CENTER_YPOS + BAR_ENDCAP_HEIGHT / 2,
+                      BAR_ENDCAP_TIPLEN);
+    display.drawHLine(display.getWidth() / 2 + 50 + BAR_ENDCAP_HOFFSET - BAR_ENDCAP_TIPLEN + 1,
+                      BAR_CENTER_YPOS - BAR_ENDCAP_HEIGHT / 2,
+                      BAR_ENDCAP_TIPLEN);
+
+    // Draw markers (25%, 38%)
+    display.drawVLine(display.getWidth() / 2 + 25, BAR_CENTER_YPOS, BAR_MARKER_LEN);
+    display.drawVLine(display.getWidth() / 2 + 38, BAR_CENTER_YPOS, BAR_MARKER_LEN);
+    display.drawVLine(display.getWidth() / 2 - 25, BAR_CENTER_YPOS, BAR_MARKER_LEN);
+    display.drawVLine(display.getWidth() / 2 - 38, BAR_CENTER_YPOS, BAR_MARKER_LEN);
+
+    // Draw double target marker
+    display.drawVLine(display.getWidth() / 2 + 12, BAR_CENTER_YPOS - BAR_MARKER_LEN, BAR_MARKER_LEN * 2);
+    display.drawVLine(display.getWidth() / 2 - 12, BAR_CENTER_YPOS - BAR_MARKER_LEN, BAR_MARKER_LEN * 2);
+#endif
+}
+
+/**
+ * @brief Draws what doesn't move on the metronome screen
+ */
+static void __metronome_background(struct display_tuner_t *tuner) {
+    // Draw metronome glyph
+    display.setFont(u8g2_font_streamline_interface_essential_alert_t);
+    display.drawStr(106, 64, "\x34");
+}
+
+/**
+ * @brief Draws what doesn't move on the soundback screen
+ */
+static void __soundback_background(struct display_tuner_t *tuner) {
+    // Draw soundback glyph
+    display.setFont(u8g2_font_streamline_interface_essential_audio_t);
+    display.drawStr(106, 64, "\x33");
+}
+
+/**
+ * @brief Starts a frame with a screen's background, leaving the rest for the screen to draw
+ * @remarks With DISPLAY_LAYERS the background is drawn once per key and copied in after
+ *          that, otherwise it's drawn every frame.
+ *
+ * @param probe profile probe for the screen's drawing time, PROFILE_PROBES for none
+ * @param layer cache for the screen's background, NULL for a blank frame
+ * @param key background variant, a change draws it again
+ * @param background draws the background into a cleared buffer
+ * @param tuner passed to background
+ */
+static void __frame_begin(profile_probe_t probe,
+                          layer_t *layer,
+                          uint16_t key,
+                          background_t background,
+                          struct display_tuner_t *tuner) {
+    frame_start = micros();
+#ifdef PROFILE
+    frame_probe = probe;
+    frame_ticks = profile_now();
+#endif
+#ifdef DISPLAY_LAYERS
+    if (layer != NULL && layer_restore(layer, display.getBufferPtr(), key)) return;
+#endif
+
+    display.clearBuffer();
+    if (background == NULL) return;
+    background(tuner);
+#ifdef DISPLAY_LAYERS
+    layer_save(layer, display.getBufferPtr(), key);
+#endif
+}
+
+/**
+ * @brief Sends whatever changed since the last frame and counts it
+ * @remarks A full sendBuffer() is 1KB over a 400kHz bus, about 25ms. Most frames only move
+ *          the tuning bar or a digit or two, so only those tiles go out. With DISPLAY_DMA
+ *          they're only queued, so the time counted is render and diff, not the bus. A frame
+ *          still queued from last time is replaced, and its tiles go out again with this one.
+ *
+ * @param traced tuner frame to close the latency trace of once it's on the panel, or NULL
+ */
+static void __frame_end(const struct display_tuner_t *traced) {
+    uint32_t rendered = micros() - frame_start;
+#ifdef PROFILE
+    profile_record(frame_probe, profile_now() - frame_ticks);
+    PROFILE_START(flush_start);
+#endif
+#ifdef DISPLAY_DMA
+    // Tiles from a dropped stream may never have reached the panel
+    if (ssd1306_lost()) display_invalidate();
+    if (ssd1306_begin()) framediff_retract(&display_diff);
+#ifdef PROFILE
+    if (traced != NULL) ssd1306_trace(traced->sequence, traced->captured);
+#endif
+    uint16_t bytes = framediff_flush(&display_diff, display.getBufferPtr(), __send_tiles);
+    ssd1306_commit();
+#else
+    uint16_t bytes = framediff_flush(&display_diff, display.getBufferPtr(), __send_tiles);
+#ifdef PROFILE
+    if (traced != NULL) profile_shown(traced->sequence, traced->captured);
+#endif
+#endif
+
+    PROFILE_STOP(PROFILE_FLUSH, flush_start);
+    uint32_t elapsed = micros() - frame_start;
+    display_counters.frames++;
+    display_counters.bytes += bytes;
+    display_counters.last_bytes = bytes;
+    display_counters.total_us += elapsed;
+    display_counters.last_us = elapsed;
+    if (elapsed > display_counters.max_us) display_counters.max_us = elapsed;
+    display_counters.render_us += rendered;
+    display_counters.last_render_us = rendered;
+    if (display_counters.frames % DISPLAY_REPORT == 0) display_report();
+}
+
+/**
+ * @brief framediff_send_t for the U8g2 display
+ */
+static void __send_tiles(uint8_t tx, uint8_t ty, uint8_t tw) {
+#ifdef DISPLAY_DMA
+    ssd1306_tiles(display.getBufferPtr(), tx, ty, tw);
+#else
+    display.updateDisplayArea(tx, ty, tw, 1);
+#endif
+}
+
+/**
+ * @brief Name of a note
  *
  * @param note enum note
- * @param output output char array
+ * @return const char* name, empty for NOTE_NONE
  */
-const void __note2char(const display_note_t note, char *output) {
-    char msg[64];
-    switch (note) {
-        case NOTE_A_FLAT:
-            strncpy(output, "Ab", 2);
-            break;
-        case NOTE_A:
-            strncpy(output, "A", 1);
-            break;
-        case NOTE_B_FLAT:
-            strncpy(output, "Bb", 2);
-            break;
-        case NOTE_B:
-            strncpy(output, "B", 1);
-            break;
-        case NOTE_C:
-            strncpy(output, "C", 1);
-            break;
-        case NOTE_C_SHARP:
-            strncpy(output, "C#", 2);
-            break;
-        case NOTE_D:
-            strncpy(output, "D", 1);
-            break;
-        case NOTE_E_FLAT:
-            strncpy(output, "Eb", 2);
-            break;
-        case NOTE_E:
-            strncpy(output, "E", 1);
-            break;
-        case NOTE_F:
-            strncpy(output, "F", 1);
-            break;
-        case NOTE_F_SHARP:
-            strncpy(output, "F#", 2);
-            break;
-        case NOTE_G:
-            strncpy(output, "G", 1);
-            break;
-        case NOTE_NONE:
-        default:
-            strncpy(output, "", 0);
-            break;
+static const char *__note_name(display_note_t note) {
+    return NOTE_NAMES[note < NOTE_NONE ? note : NOTE_NONE];
+}
+
+/**
+ * @brief Draws every note name and digit character once in one of the big fonts and caches it
+ * @remarks Each glyph is drawn on its own into the cleared framebuffer and captured from
+ *          there, with the advance and right edge U8g2 measures strings by. The note name
+ *          widths are worked out here too, so centering one later is a lookup.
+ *
+ * @param font font to cache
+ */
+static void __cache_glyphs(text_font_t font) {
+    glyph_font_t *glyphs = &text_glyphs[font];
+    display.setFont(TEXT_FONTS_U8G2[font]);
+    glyphs->height = display.getAscent() - display.getDescent();
+
+    for (const char *c = GLYPH_CHARSET; *c != '\0'; c++) {
+        char single[2] = {*c, '\0'};
+        char pair[3]   = {*c, *c, '\0'};
+        uint8_t extent = display.getStrWidth(single);
+
+        display.clearBuffer();
+        display.drawStr(GLYPH_MAX_WIDTH / 2, display.getAscent(), single);
+        glyph_capture(glyphs,
+                      *c,
+                      display.getBufferPtr(),
+                      GLYPH_MAX_WIDTH / 2,
+                      display.getAscent(),
+                      display.getStrWidth(pair) - extent,
+                      extent);
+    }
+    display.clearBuffer();
+
+    for (uint8_t note = 0; note <= NOTE_NONE; note++) {
+        note_half_widths[font][note] = glyph_width(glyphs, NOTE_NAMES[note]) / 2;
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Width of a string in one of the big fonts
+ */
+static uint8_t __text_width(text_font_t font, const char *str) {
+#ifdef DISPLAY_GLYPHS
+    return glyph_width(&text_glyphs[font], str);
+#else
+    display.setFont(TEXT_FONTS_U8G2[font]);
+    return display.getStrWidth(str);
+#endif
+}
+
+/**
+ * @brief Ascent minus descent of one of the big fonts
+ */
+static uint8_t __text_height(text_font_t font) {
+#ifdef DISPLAY_GLYPHS
+    return text_glyphs[font].height;
+#else
+    display.setFont(TEXT_FONTS_U8G2[font]);
+    return display.getAscent() - display.getDescent();
+#endif
+}
+
+/**
+ * @brief Half the width of a note name, what it's centered by
+ */
+static uint8_t __note_half_width(text_font_t font, display_note_t note) {
+#ifdef DISPLAY_GLYPHS
+    return note_half_widths[font][note < NOTE_NONE ? note : NOTE_NONE];
+#else
+    return __text_width(font, __note_name(note)) / 2;
+#endif
+}
+
+/**
+ * @brief Draws a note name or number in one of the big fonts
+ * @remarks With DISPLAY_GLYPHS it's copied from the glyph cache, only falling back to U8g2
+ *          for a character the cache doesn't have.
+ *
+ * @param font font to draw in
+ * @param x origin
+ * @param y baseline
+ * @param str string to draw
+ */
+static void __draw_text(text_font_t font, uint8_t x, uint8_t y, const char *str) {
+#ifdef DISPLAY_GLYPHS
+    if (glyph_draw(display.getBufferPtr(), &text_glyphs[font], x, y, str)) return;
+#endif
+    display.setFont(TEXT_FONTS_U8G2[font]);
+    display.drawStr(x, y, str);
+}
@@ -1,4 +1,5 @@
 #include "error.h"
+#include "log.h"
 
 /**
  * @brief Inits the error handling functions
@@ -11,10 +12,14 @@ void error_init() {
 
 /**
  * @brief Halts execution after a fatal error
+ * @note Safe from either core and from an IRQ. Only core0's thread context flushes what
+ *       was queued leading up to it, anywhere else the log rings would get a second
+ *       consumer racing the loop's log_drain(), so the message is printed on its own.
  *
  * @param msg cause of fatal error
  */
 void fatal_error(const char *msg) {
+    if (get_core_num() == 0 && __get_current_exception() == 0) log_drain();
     Serial.println("### FATAL ERROR ###");
     Serial.println(msg);
     Serial.println("Please reset.");
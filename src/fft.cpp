@@ -1,278 +1,617 @@
 #include "fft.h"
 
+#include "decimate.h"
+#include "fft_engine.h"
+#include "goertzel.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+
 // Private defs
 const void __populate_freq_lut(uint16_t tune_a);
-const fix15 __average(fix15 *, uint8_t count);
-const fix15 __variance(fix15 *, uint8_t count, fix15 avg);
-const fix15 __median(fix15 *arr, uint8_t count);
+static fix15 __smooth_rolling(fix15 interpolated);
+static void __restart_frame();
+static uint16_t *__take_capture(uint32_t *stamp);
+static void __release_capture();
+static uint16_t *__next_window(uint16_t *errors);
+void __fft_helper_irq();
 
 // Global variables
 uint16_t *data_input                 = NULL;
-fix15 *data_output                   = NULL;
-fix15 *Sinewave                      = NULL;
-uint fft_dma_channel                 = 0;
-uint16_t CAPTURE_DEPTH               = 0;
-uint16_t CAPTURE_BITS                = 0;
+uint16_t *last_frame                 = NULL;
+uint32_t data_stamp                  = 0; // profile_now() when data_input landed
+uint32_t frame_stamp                 = 0; // and when the newest capture in last_frame did
+capture_ring_t *capture_source       = NULL; // where captures come from instead, see fft_set_capture_ring()
+int8_t capture_held                  = CAPTURE_NONE; // capture last_frame points into
+uint16_t frame_fill                  = 0;
+uint16_t frame_errors                = 0;
+uint16_t fft_hop                     = 0; // decimated samples between sliding windows, 0 for back to back frames
+uint16_t hop_fill                    = 0; // samples in since the last window
+uint16_t history_head                = 0; // oldest sample of the sliding history, overwritten next
+uint16_t *stream_capture             = NULL; // capture being fed into the history
+uint16_t stream_offset               = 0;
+uint32_t stream_stamp                = 0;
+// Everything frame sized lives in dsp_arena, these just name the pieces
+complex15 *spectrum                  = dsp_arena.spectrum;
+fix15 *Window                        = dsp_arena.window;
+uint16_t *BitReverse                 = dsp_arena.bit_reverse;
+uint16_t *frame_buffer               = dsp_arena.frame;
+const fft_ops_t *fft_ops             = NULL;
+uint16_t capture_depth               = 0; // samples per mic capture, fixed by fft_init()
+uint16_t frame_depth                 = 0; // samples per FFT frame, fft_set_size() can change it
+uint8_t frame_bits                   = 0;
 uint32_t SAMPLE_RATE                 = 0;
 uint16_t tune_a_value                = 0;
+fft_input_t fft_input_mode           = FFT_INPUT_REAL;
+fft_kernel_t fft_kernel              = FFT_KERNEL_RADIX4;
+fft_window_t fft_window              = FFT_WINDOW_HANN;
+uint8_t fft_frac                     = FFT_FRAC;
+smooth_mode_t fft_smoothing          = SMOOTH_ROLLING;
+uint8_t fft_decimation               = DECIMATION_FACTOR;
+bool fft_parallel                    = false;
+bool fft_refining                    = false;
+bool fft_helper_ready                = false;
+uint32_t fft_helper_pending          = 0; // pass + 1 the helper has been woken for, 0 once its half is done
+irq_handler_t fft_helper_chained     = NULL; // the helper core's own FIFO handler, for anything that isn't a pass
+fft_job_t fft_job                    = {0};
 double FREQ2OCTAVE_CONSTANT          = 0;
-double LOG_1_12_BASE                 = 0;
 
-fix15 rolling_buffer[ROLLING_ITEMS]  = {0};
-fix15 rolling_average                = 0;
-fix15 rolling_deviance               = 0;
-uint8_t rolling_index                = 0;
-uint8_t rolling_outlier_count        = 0;
-fix15 rolling_outlier[ROLLING_ITEMS] = {0};
+stats_t rolling_stats;
+fix15 rolling_average                         = 0;
+fix15 rolling_deviance                        = 0;
+uint8_t rolling_outlier_count                 = 0;
+fix15 rolling_outlier[ROLLING_OUTLIER_THRESH] = {0};
+one_euro_t one_euro_filter;
+kalman_t kalman_filter;
 
 double FREQ_LUT[12 * NUM_OCTAVES]    = {0};
+int64_t freq_log2_c0                 = 0; // log2(FREQ_LUT[0]) in Q30
 
 /**
  * @brief initializes the FFT functionality
  *
- * @param fft_output fix15 array to output FFT data to
- * @param num_bits equal to CAPTURE_BITS
+ * @param num_bits log2 of the mic capture length, also the initial frame size
+ * @param samplerate capture sample rate
  */
-void fft_init(fix15 *fft_output, uint16_t num_bits, uint32_t samplerate) {
-    data_output   = fft_output;
-    CAPTURE_BITS  = num_bits;
-    CAPTURE_DEPTH = 1 << num_bits;
+void fft_init(uint16_t num_bits, uint32_t samplerate) {
+    if (num_bits > FFT_MAX_BITS) { fatal_error("FFT depth is larger than the DSP arena"); }
+    capture_depth = 1 << num_bits;
     SAMPLE_RATE   = samplerate;
 
-    char msg[64];
-    sprintf(msg, "FFT inited with %d depth (%d bits)", CAPTURE_DEPTH, CAPTURE_BITS);
-    print_msg(msg, INFO);
+    // Bit-reversal permutation for the deepest frame, shorter transforms shift it down
+    for (uint16_t i = 0; i < FFT_MAX_DEPTH; i++) {
+        uint16_t v = 0;
+        for (uint16_t b = 0; b < FFT_MAX_BITS; b++) {
+            if (i & (1 << b)) v |= 1 << (FFT_MAX_BITS - 1 - b);
+        }
+        BitReverse[i] = v;
+    }
+
+    if (!fft_set_size(num_bits)) { fatal_error("No FFT compiled for this depth"); }
+
+    // Decimated samples collect in frame_buffer until there's a full frame
+    fft_set_decimation(fft_decimation);
+    fft_reset_smoothing();
+
+    FREQ2OCTAVE_CONSTANT = NOTE_RATIOS.values[NOTE_A4_INDEX + 1];
+    __populate_freq_lut(tune_a_value);
+}
 
-    // Sinewave generation
-    Sinewave = (fix15 *)malloc(sizeof(fix15) * CAPTURE_DEPTH);
-    for (uint16_t i = 0; i < CAPTURE_DEPTH; i++) {
-        Sinewave[i] = float2fix15(sin(6.283 * ((float)i / CAPTURE_DEPTH)));
+/**
+ * @brief Switches to another compiled FFT size, takes effect from the next frame
+ * @note Call from the core running do_fft(). Captures stay the length fft_init() was given,
+ *       frames are cut from or stitched across them as needed
+ *
+ * @param bits log2 of the frame length, FFT_MIN_BITS to FFT_MAX_BITS
+ * @return true if that size is compiled in
+ */
+bool fft_set_size(uint8_t bits) {
+    const fft_ops_t *ops = fft_engine_ops(bits, fft_frac);
+    if (ops == NULL) {
+        LOG_WARNING("FFT size isn't compiled in");
+        return false;
     }
 
-    // DMA config to transfer raw data into a FFT buffer
-    fft_dma_channel        = dma_claim_unused_channel(true);
-    dma_channel_config cfg = dma_channel_get_default_config(fft_dma_channel);
+    fft_ops     = ops;
+    frame_bits  = bits;
+    frame_depth = 1 << bits;
 
-    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_32); // Use 32-bit transfers
-    channel_config_set_read_increment(&cfg, true);            // Read from incrementing address
-    channel_config_set_write_increment(&cfg, true);           // Write to an incrementing address
+    LOG_INFO("FFT set to %d depth (%d bits)", frame_depth, frame_bits);
 
-    dma_channel_configure(fft_dma_channel,
-                          &cfg,
-                          data_output,       // destination buffer
-                          data_input,        // source FIFO
-                          CAPTURE_DEPTH / 2, // transfer count
-                          false              // don't start yet
-    );
+    // Window table, only rebuilt when the depth or the window type changes
+    fft_set_window(fft_window);
 
-    FREQ2OCTAVE_CONSTANT = pow(2, (double)1 / 12);
-    LOG_1_12_BASE        = 1 / log((double)1 / 12);
-    __populate_freq_lut(tune_a_value);
+    // A part-filled frame at the old size is no use at the new one
+    __restart_frame();
+    return true;
+}
+
+/**
+ * @brief Current frame size
+ *
+ * @return uint8_t log2 of the frame length
+ */
+uint8_t fft_size() {
+    return frame_bits;
+}
+
+/**
+ * @brief Selects between the full complex FFT and the packed real-input FFT
+ *
+ * @param mode FFT_INPUT_REAL (default) or FFT_INPUT_COMPLEX
+ */
+void fft_set_input_mode(fft_input_t mode) {
+    fft_input_mode = mode;
+}
+
+/**
+ * @brief Selects the butterfly kernel used by do_fft()
+ *
+ * @param kernel FFT_KERNEL_RADIX4 (default) or FFT_KERNEL_RADIX2
+ */
+void fft_set_kernel(fft_kernel_t kernel) {
+    fft_kernel = kernel;
+}
+
+/**
+ * @brief Selects the fixed-point format the transform works in, takes effect from the next frame
+ * @remarks peak() always reports fix15, so nothing past the transform sees the difference
+ *          except in precision.
+ *
+ * @param frac fractional bits, FFT_FRAC (default) or FFT_ALT_FRAC
+ * @return true if that format is compiled in
+ */
+bool fft_set_format(uint8_t frac) {
+    if (fft_engine_ops(FFT_MIN_BITS, frac) == NULL) {
+        LOG_WARNING("FFT format isn't compiled in");
+        return false;
+    }
+
+    fft_frac = frac;
+    if (frame_bits != 0) fft_ops = fft_engine_ops(frame_bits, frac);
+    return true;
+}
+
+/**
+ * @brief Selects the window applied to every frame and rebuilds its table
+ * @remarks Every table is scaled to the same mean as Hann, so peak heights and
+ *          LOW_NOISE_THRESH mean the same thing whichever window is in use.
+ *          Flat-top goes negative and peaks above 1, both of which fix15 holds fine.
+ *          The tables themselves are generated at compile time, this only copies one.
+ *
+ * @param window FFT_WINDOW_HANN (default), FFT_WINDOW_BLACKMAN_HARRIS, FFT_WINDOW_FLAT_TOP or FFT_WINDOW_KAISER
+ */
+void fft_set_window(fft_window_t window) {
+    fft_window = window;
+    if (frame_depth == 0) return;
+
+    // Unfold the half window in flash, every 2^(FFT_MAX_BITS - frame_bits)th point matches this depth
+    const fix15 *half = WINDOW_TABLES.values[window];
+    for (uint16_t i = 0; i <= frame_depth / 2; i++) {
+        Window[i] = half[i << (FFT_MAX_BITS - frame_bits)];
+    }
+    for (uint16_t i = frame_depth / 2 + 1; i < frame_depth; i++) {
+        Window[i] = Window[frame_depth - i];
+    }
+}
+
+/**
+ * @brief Selects how fft_smooth() filters the raw estimates, and starts it afresh
+ * @remarks The rolling mean needs ROLLING_OUTLIER_THRESH frames to accept a new note and
+ *          then drags the old one along until its history turns over. One-Euro takes
+ *          ONE_EURO_CONFIRM frames of the new note to follow it and Kalman KALMAN_CONFIRM, or
+ *          KALMAN_OCTAVE_CONFIRM for an octave, see smooth.h.
+ *
+ * @param mode SMOOTH_ROLLING (default), SMOOTH_ONE_EURO, SMOOTH_KALMAN or SMOOTH_OFF
+ */
+void fft_set_smoothing(smooth_mode_t mode) {
+    fft_smoothing = mode;
+    fft_reset_smoothing();
+}
+
+/**
+ * @brief Splits every radix-4 pass between this core and the helper core
+ * @note Needs fft_parallel_helper_init() to have run on the other core, otherwise stays off
+ *
+ * @param enable true to split passes, false to run the whole FFT on this core
+ */
+void fft_set_parallel(bool enable) {
+    fft_parallel = enable && __atomic_load_n(&fft_helper_ready, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Runs every raw estimate through the Goertzel bank before it's smoothed
+ * @remarks The bank sits around the estimate's nearest note, see goertzel_refine(), and
+ *          costs GOERTZEL_BINS multiply-adds per sample of the frame. Refining ahead of
+ *          fft_smooth() means the smoothing settles the refined value rather than the
+ *          refinement undoing the smoothing.
+ *
+ * @param enable true to refine, false to smooth the interpolated estimate as is
+ */
+void fft_set_refine(bool enable) {
+    fft_refining = enable;
+}
+
+/**
+ * @brief Refines a raw estimate from the newest frame, if fft_set_refine() is on
+ * @note Both engines call this on their raw estimate, just before fft_smooth()
+ *
+ * @param freq raw estimate in Hz, left alone if 0 or less
+ * @return fix15 refined estimate
+ */
+fix15 fft_refine(fix15 freq) {
+    if (!fft_refining || freq <= 0) return freq;
+
+    uint8_t note_index;
+    int8_t cents;
+    PROFILE_START(note_start);
+    freq2note(freq, &note_index, &cents);
+    PROFILE_STOP(PROFILE_FREQ2NOTE, note_start);
+    return goertzel_refine(freq, note_index);
 }
 
+/**
+ * @brief Makes the calling core the FFT helper, call once from the core not running do_fft()
+ * @remarks The helper only does work from its SIO FIFO interrupt, so whatever it runs in its
+ *          loop is paused for about half an FFT per frame and otherwise left alone. The
+ *          interrupt takes over from the core's own FIFO handler, which idleOtherCore()
+ *          relies on, and hands it any FIFO word that doesn't belong to a pass. It runs at
+ *          the lowest priority so other interrupts on this core can still preempt it.
+ *
+ */
+void fft_parallel_helper_init() {
+    uint irq = SIO_IRQ_PROC0 + get_core_num();
+
+    irq_set_enabled(irq, false);
+    fft_helper_chained = irq_get_exclusive_handler(irq);
+    if (fft_helper_chained) irq_remove_handler(irq, fft_helper_chained);
+
+    irq_set_exclusive_handler(irq, __fft_helper_irq);
+    irq_set_priority(irq, PICO_LOWEST_IRQ_PRIORITY);
+    irq_set_enabled(irq, true);
+    __atomic_store_n(&fft_helper_ready, true, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Sets how many captured samples go into each sample the FFT sees
+ * @note A factor of D narrows the analysed band to MIC_SAMPLE_RATE / 2D and makes the
+ *       bins D times finer, but each frame then needs D captures
+ *
+ * @param factor decimation factor, 1 feeds captures straight to the FFT
+ */
+void fft_set_decimation(uint8_t factor) {
+    decimate_init(factor);
+    fft_decimation = factor;
+    __restart_frame();
+}
+
+/**
+ * @brief Sets how often a sliding window is analysed
+ * @remarks With a hop of H, fft_next_frame() hands out the newest frame every H decimated
+ *          samples rather than every frame length, so results come frame length / H times
+ *          as often at the same resolution. Each frame costs the same, so the DSP load goes
+ *          up by as much.
+ *
+ * @param hop decimated samples between frames, 0 or a frame length or more for back to back frames
+ */
+void fft_set_hop(uint16_t hop) {
+    fft_hop = hop;
+    __restart_frame();
+}
+
+/**
+ * @brief Hands a capture straight to the DSP, for when there's no capture ring
+ * @note Nothing stops the next capture landing in the same buffer while it's being read,
+ *       the mic uses fft_set_capture_ring() for that. The host benchmark feeds frames here.
+ *
+ * @param data CAPTURE_DEPTH samples
+ */
 void mic_dma_handler(uint16_t *data) {
     // This will run each time the DMA completes, so keep it snappy!
+    data_stamp = profile_now(); // the capture just landed, latency is counted from here
     data_input = data;
 }
 
 /**
- * @brief Computes the FFT of data_input into data_output
+ * @brief Computes the FFT of data_input into the arena's spectrum and picks the pitch
  *
- * @param data_output fix15 array to store result
- * @return uint16_t index of max value, 0 if invalid
+ * @return fix15 smoothed frequency, 0 if no new frame, -1 if the signal is too quiet
  */
 fix15 do_fft() {
-    if (data_input == NULL) {
-        // No pending data, so return
-        return 0;
-    }
-
-    char msg[64];
     // dump_array_uint16(data_input, 64, "do_fft input:");
 
-    // Expected input is an CAPTURE_DEPTH length array of 12-bit readings
-    // Copy 16-bit data into space that's zero padded to be 32-bit
-    // then copy that 32-bit into array
-    // We want to move this into a seperate buffer
-    // dma_channel_set_read_addr(fft_dma_channel, data_input, false);
-    // dma_channel_set_write_addr(fft_dma_channel, data_output, true);
-    // dma_channel_start(fft_dma_channel);
-    // do we need to wait for DMA to start?
-
     // Error checking: error flag stored in bit 15 of the ADC data
     uint16_t data_error = 0;
-    // this loop is slower than the DMA, so shouldn't have a race condition
-    for (uint16_t i = 0; i < CAPTURE_DEPTH; i++) {
-        if (data_input[i] & 0x8000) {
-            // Clear error bit for processing
-            data_error++;
-            data_input[i] &= 0x7FFF;
-        }
-        data_output[i] = int2fix15(data_input[i]);
-        // uint16_t amplitude = 400;
-        // uint16_t signalFrequency = 2000;
-        // float cycles = (((CAPTURE_DEPTH-1) * signalFrequency) / SAMPLE_RATE);
-        // data_output[i] = float2fix15((amplitude * (sin((i * (twoPi * cycles)) / CAPTURE_DEPTH))) / 2.0 + amplitude);
-    }
 
-    if (data_error) {
-        sprintf(msg, "%d ADC errors detected out of %d samples", data_error, CAPTURE_DEPTH);
-        print_msg(msg, WARNING);
+    // Step -1: anti-alias filter and downsample, the FFT only runs once a frame is full
+    FFT_STAGE_MARK(FFT_STAGE_DECIMATE);
+    uint16_t *frame = fft_next_frame(&data_error);
+    if (frame == NULL) {
+        // No pending data, so return
+        FFT_STAGE_MARK(FFT_STAGE_DONE);
+        return 0;
     }
 
-    // transfer complete, so we reset the input buffer
-    data_input = NULL;
+    // Step 0: error check, convert and window straight out of the capture buffer.
+    // The frame is only read, so it's never written back while the DMA may still want it
+    FFT_STAGE_MARK(FFT_STAGE_INGEST);
+    data_error += fft_ops->ingest(frame, spectrum, fft_input_mode);
 
-    // Step 0: windowing wising Hann function
-    for (uint16_t i = 0; i < CAPTURE_DEPTH; i++) {
-        fix15 multiplier = (int2fix15(1) - Sinewave[abs(i - CAPTURE_DEPTH / 4) & 0xFFFF]) >> 1;
-        data_output[i]   = multiply_fix15(multiplier, data_output[i]);
+    if (data_error) {
+        LOG_WARNING("%d ADC errors detected out of %d samples", data_error, frame_depth);
     }
 
-    // dump_array_fix15(data_output, 64, "do_fft transfer");
     // dump_array_double(vReal, 64, "do_fft transfer");
 
     /* FFT Algo adapted from https://vanhunteradams.com/FFT/FFT.html */
 
-    // Step 1: bit reversal
-    // Here, we reverse the order of the bits of the indices
-    for (uint16_t i = 1; i < CAPTURE_DEPTH - 1; i++) {
-        // We can skip the first and last indices because 0x0000 and 0xFFFF flipped is just itself
-        // Bit reversal from https://graphics.stanford.edu/~seander/bithacks.html#ReverseParallel
-        uint16_t v = i; // 16-bit word to reverse bit order
-
-        // swap odd and even bits
-        v = ((v >> 1) & 0x5555) | ((v & 0x5555) << 1);
-        // swap consecutive pairs
-        v = ((v >> 2) & 0x3333) | ((v & 0x3333) << 2);
-        // swap nibbles ...
-        v = ((v >> 4) & 0x0F0F) | ((v & 0x0F0F) << 4);
-        // swap bytes
-        v = ((v >> 8) & 0x00FF) | ((v & 0x00FF) << 8);
-        // Adjust for total number of samples
-        v >>= (16 - CAPTURE_BITS);
-
-        // Don't swap what's already been swapped
-        if (v <= i) continue;
-
-        // Swap bit-reversed indices
-        fix15 tmp      = data_output[i];
-        data_output[i] = data_output[v];
-        data_output[v] = tmp;
-    }
-
-    // dump_array_fix15(data_output, 64, "do_fft bitreversal");
-
-    // Step 2: FFT (Danielson-Lanczos)
-    fix15 imag_buf[CAPTURE_DEPTH] = {0};
-    uint16_t fft_len              = 1;
-    uint16_t fft_bits             = CAPTURE_BITS - 1;
-    while (fft_len < CAPTURE_DEPTH) {
-        // Determine new FFT length
-        uint16_t new_fft_len = fft_len << 1;
-
-        // Combine elements in FFTs
-        for (uint16_t i = 0; i < fft_len; i++) {
-            // Get trig values for this element (0.5*cos/sin(sample number))
-            uint32_t bt    = i << fft_bits;
-            fix15 sin_term = -Sinewave[bt];
-            fix15 cos_term = Sinewave[(bt + CAPTURE_DEPTH / 4) & 0xFFFF];
-            sin_term >>= 1;
-            cos_term >>= 1;
-
-            for (uint16_t k = i; k < CAPTURE_DEPTH; k += new_fft_len) {
-                uint32_t bn     = k + fft_len;
-
-                fix15 real      = multiply_fix15(cos_term, data_output[bn]) - multiply_fix15(sin_term, imag_buf[bn]);
-                fix15 imag      = multiply_fix15(cos_term, imag_buf[bn]) + multiply_fix15(sin_term, data_output[bn]);
-
-                fix15 real_tmp  = data_output[k] >> 1;
-                fix15 imag_tmp  = imag_buf[k] >> 1;
-
-                data_output[bn] = real_tmp - real;
-                imag_buf[bn]    = imag_tmp - imag;
-                data_output[k]  = real_tmp + real;
-                imag_buf[k]     = imag_tmp + imag;
-            }
-        }
-        fft_bits--;
-        fft_len = new_fft_len;
-    }
+    // Steps 1 & 2: the transform itself, with the real-input split as step 2.5
+    fft_ops->transform(spectrum, fft_input_mode, fft_kernel);
 
     // Step 3: Peak detection
+    FFT_STAGE_MARK(FFT_STAGE_PEAK);
     fix15 max_val  = 0;
-    uint16_t i_max = 0;
-    for (uint16_t i = 1; i < CAPTURE_DEPTH / 2; i++) {
-        if ((data_output[i] > data_output[i - 1]) && data_output[i] > data_output[i + 1]) {
-            if (data_output[i] > max_val) {
-                max_val = data_output[i];
-                i_max   = i;
-            }
-        }
-    }
+    uint16_t i_max = fft_ops->peak(spectrum, &max_val);
 
-    sprintf(msg, "DC: %f, peak: %f", fix2float15(data_output[0]), fix2float15(max_val));
-    print_msg(msg, DEBUG);
+    LOG_DEBUG("DC: %f, peak: %f", fix2float15(spectrum[0].re), fix2float15(max_val));
 
     // Step 3.5: Low-Noise Cutoff
-    if (max_val < LOW_NOISE_THRESH) { return int2fix15(-1); }
+    if (max_val < LOW_NOISE_THRESH) {
+        FFT_STAGE_MARK(FFT_STAGE_DONE);
+        return int2fix15(-1);
+    }
 
     // Step 4: Weighted interpolation
-    fix15 delta = (data_output[i_max - 1] - data_output[i_max + 1]) >> 1;
-    delta       = divide_fix15(delta, (data_output[i_max - 1] + data_output[i_max + 1] - 2 * data_output[i_max]));
-    fix15 interpolated = multiply_fix15((int2fix15(i_max) + delta), float2fix15((float)SAMPLE_RATE / CAPTURE_DEPTH));
+    FFT_STAGE_MARK(FFT_STAGE_INTERPOLATE);
+    fix15 delta = (spectrum[i_max - 1].re - spectrum[i_max + 1].re) >> 1;
+    delta       = divide_fix15(delta, (spectrum[i_max - 1].re + spectrum[i_max + 1].re - 2 * spectrum[i_max].re));
+    fix15 interpolated = multiply_fix15((int2fix15(i_max) + delta),
+                                        float2fix15((float)SAMPLE_RATE / fft_decimation / frame_depth));
 
-    // sprintf(msg, "Original: %f Interpolated: %f", fix2float15(data_output[i_max]), fix2float15(interpolated));
-    // print_msg(msg, DEBUG);
+    // LOG_DEBUG("Original: %f Interpolated: %f", fix2float15(spectrum[i_max].re), fix2float15(interpolated));
+
+    // Step 4.5: filter bank around the nearest note, before the smoothing sees it
+    FFT_STAGE_MARK(FFT_STAGE_REFINE);
+    interpolated = fft_refine(interpolated);
 
     // Step 5: rolling average w/ outlier detection
+    FFT_STAGE_MARK(FFT_STAGE_AVERAGE);
+    fix15 average = fft_smooth(interpolated);
+
+    FFT_STAGE_MARK(FFT_STAGE_DONE);
+    return average;
+}
+
+/**
+ * @brief Takes captures from a ring, which gets each one back once it's been used
+ *
+ * @param ring filled by the mic DMA, NULL to go back to mic_dma_handler()
+ */
+void fft_set_capture_ring(capture_ring_t *ring) {
+    if (capture_source != NULL) capture_ring_release(capture_source, capture_held);
+    capture_source = ring;
+    capture_held   = CAPTURE_NONE;
+    stream_capture = NULL;
+    last_frame     = NULL;
+}
+
+/**
+ * @brief Pulls the next full frame of samples for the pitch engines
+ * @note Captures are decimated into a frame buffer, so with a decimation factor of D
+ *       only every Dth call returns a frame. With a hop set, see fft_set_hop(), frames
+ *       overlap and come every hop samples instead
+ *
+ * @param errors incremented for each sample with the ADC error flag set, only the new
+ *               hop's worth when frames overlap
+ * @return uint16_t* fft_frame_length() samples, NULL if no frame is ready
+ */
+uint16_t *fft_next_frame(uint16_t *errors) {
+    if (fft_hop != 0 && fft_hop < frame_depth) return __next_window(errors);
+
+    // The frame that came straight out of the held capture has been used by now,
+    // and whatever a sliding window left of its capture goes with it
+    if (capture_held != CAPTURE_NONE) {
+        __release_capture();
+        last_frame = NULL;
+    }
+    stream_capture    = NULL;
+    uint32_t stamp    = 0;
+    uint16_t *capture = __take_capture(&stamp);
+    if (capture == NULL) return NULL;
+    if (fft_decimation == 1 && frame_depth <= capture_depth) {
+        // Read in place, so a ring capture stays held until the next call
+        last_frame  = capture;
+        frame_stamp = stamp;
+        return capture;
+    }
+
+    uint16_t room = frame_depth - frame_fill;
+    if (fft_decimation == 1) {
+        // Frames longer than a capture are stitched from consecutive ones, flags and all
+        uint16_t count = room < capture_depth ? room : capture_depth;
+        memcpy(frame_buffer + frame_fill, capture, count * sizeof(uint16_t));
+        frame_fill += count;
+    } else {
+        frame_fill += decimate(capture, capture_depth, frame_buffer + frame_fill, room, &frame_errors);
+    }
+    // Copied out, so the DMA can have it back straight away
+    __release_capture();
+    if (frame_fill < frame_depth) return NULL;
+
+    // Frame is full, hand it over and start the next one
+    *errors += frame_errors;
+    frame_fill   = 0;
+    frame_errors = 0;
+    last_frame   = frame_buffer;
+    frame_stamp  = stamp;
+    return frame_buffer;
+}
+
+/**
+ * @brief Most recent frame handed out by fft_next_frame()
+ * @note Only valid until the next fft_next_frame(), or the next capture without a ring
+ *
+ * @return uint16_t* frame samples, NULL before the first frame
+ */
+uint16_t *fft_last_frame() {
+    return last_frame;
+}
+
+/**
+ * @brief When the newest capture in the frame from fft_next_frame() landed
+ * @note The oldest sample in it is fft_frame_length() samples older
+ *
+ * @return uint32_t profile_now() when the DMA finished the newest capture in it
+ */
+uint32_t fft_frame_stamp() {
+    return frame_stamp;
+}
+
+/**
+ * @brief Window fft_set_window() selected, as applied to every frame, fft_frame_length() entries
+ *
+ * @return const fix15* window table
+ */
+const fix15 *fft_window_table() {
+    return Window;
+}
+
+
+/**
+ * @brief Sample rate of the frames returned by fft_next_frame()
+ *
+ * @return uint32_t samples per second after decimation
+ */
+uint32_t fft_frame_rate() {
+    return SAMPLE_RATE / fft_decimation;
+}
+
+/**
+ * @brief Number of samples in each frame returned by fft_next_frame()
+ *
+ * @return uint16_t frame length
+ */
+uint16_t fft_frame_length() {
+    return frame_depth;
+}
+
+/**
+ * @brief Forgets the smoothing history, e.g. after switching pitch engines
+ *
+ */
+void fft_reset_smoothing() {
+    stats_init(&rolling_stats, ROLLING_ITEMS);
+    rolling_average       = 0;
+    rolling_deviance      = 0;
+    rolling_outlier_count = 0;
+    one_euro_reset(&one_euro_filter);
+    kalman_reset(&kalman_filter);
+}
+
+/**
+ * @brief Smooths the raw estimates with the filter fft_set_smoothing() picked, shared by all pitch engines
+ *
+ * @param interpolated newest raw frequency estimate
+ * @return fix15 smoothed frequency
+ */
+fix15 fft_smooth(fix15 interpolated) {
+    switch (fft_smoothing) {
+        case SMOOTH_OFF: return interpolated;
+        case SMOOTH_ONE_EURO: {
+            // Estimates per second in Q16, the filter's time step, one per hop when sliding
+            uint16_t step = fft_hop != 0 && fft_hop < frame_depth ? fft_hop : frame_depth;
+            uint32_t rate = ((uint64_t)fft_frame_rate() << 16) / step;
+            return one_euro_update(&one_euro_filter, interpolated, rate);
+        }
+        case SMOOTH_KALMAN: return kalman_update(&kalman_filter, interpolated);
+        default: return __smooth_rolling(interpolated);
+    }
+}
+
+/**
+ * @brief Rolling average with outlier detection
+ * @remarks The history is a stats_t, so each frame costs the same however long
+ *          ROLLING_ITEMS is, and a run of outliers replaces it with a handful of pushes.
+ *
+ * @param interpolated newest raw frequency estimate
+ * @return fix15 smoothed frequency
+ */
+static fix15 __smooth_rolling(fix15 interpolated) {
     if (interpolated > rolling_average + rolling_deviance || interpolated < rolling_average - rolling_deviance) {
         if (rolling_outlier_count >= ROLLING_OUTLIER_THRESH) {
-            // Swap in array
-            print_msg("rolling average: swap buffers", INFO);
-            memcpy(rolling_buffer, rolling_outlier, ROLLING_ITEMS * sizeof(fix15));
-            rolling_index         = ROLLING_OUTLIER_THRESH;
+            // The pitch really has moved, so the shelved outliers become the whole history
+            LOG_INFO("rolling average: swap buffers");
+            stats_reset(&rolling_stats);
+            for (uint8_t i = 0; i < ROLLING_OUTLIER_THRESH; i++) stats_push(&rolling_stats, rolling_outlier[i]);
             rolling_outlier_count = 0;
         } else {
             // This is an outlier, so shelve it
             rolling_outlier[rolling_outlier_count] = interpolated;
             rolling_outlier_count++;
-            sprintf(msg,
-                    "Skipped frequency of %f (mean=%f, var=%f)",
-                    fix2float15(interpolated),
-                    fix2float15(rolling_average),
-                    fix2float15(rolling_deviance));
-            // print_msg(msg, DEBUG);
+            // LOG_DEBUG("Skipped frequency of %f (mean=%f, var=%f)", fix2float15(interpolated), ...);
             return rolling_average;
         }
     }
 
-    // Otherwise, add to buffer
+    // Otherwise, add to the history
     rolling_outlier_count = 0;
-    sprintf(msg,
-            "Added frequency of %f (mean=%f, var=%f)",
-            fix2float15(interpolated),
-            fix2float15(rolling_average),
-            fix2float15(rolling_deviance));
-    rolling_buffer[rolling_index] = interpolated;
-    rolling_average               = __average(rolling_buffer, ROLLING_ITEMS);
-    rolling_deviance              = multiply_fix15(float2fix15(ROLLING_DEVIANCE_MULT), rolling_average);
-    // rolling_variance = __variance(rolling_buffer, ROLLING_ITEMS, rolling_average);
-
-    // rolling_buffer[rolling_index] = interpolated;
-    // rolling_average = __median(rolling_buffer, ROLLING_ITEMS);
-    // sprintf(msg, "Median value is %f", fix2float15(rolling_average));
-    // print_msg(msg, DEBUG);
-
-    if (rolling_index < ROLLING_ITEMS) {
-        rolling_index++;
-    } else {
-        rolling_index = 0;
-    }
+    stats_push(&rolling_stats, interpolated);
+#ifdef ROLLING_MEDIAN
+    rolling_average = stats_median(&rolling_stats);
+#else
+    rolling_average = stats_mean(&rolling_stats);
+#endif
+    rolling_deviance = multiply_fix15(float2fix15(ROLLING_DEVIANCE_MULT), rolling_average);
 
     return rolling_average;
 }
 
+/**
+ * @brief Runs one pass of the radix-4 FFT, on both cores if parallel stages are enabled
+ * @remarks The helper core is woken through the SIO FIFO and clears fft_helper_pending once
+ *          its half is done, so returning from here is the barrier between Danielson-Lanczos
+ *          stages. Nothing comes back through this core's FIFO, where its own handler would
+ *          take it.
+ *
+ * @param pass which pass of the transform to run on fft_job
+ */
+void fft_run_pass(fft_pass_t pass) {
+    if (!fft_parallel) {
+        fft_job.run(pass, 0, 1);
+        return;
+    }
+
+    // fft_job and the data must be visible before the helper starts
+    __atomic_store_n(&fft_helper_pending, (uint32_t)pass + 1, __ATOMIC_RELEASE);
+    multicore_fifo_push_blocking(pass);
+    fft_job.run(pass, 0, 2);
+    while (__atomic_load_n(&fft_helper_pending, __ATOMIC_ACQUIRE) != 0) tight_loop_contents();
+}
+
+/**
+ * @brief Helper core side of fft_run_pass(), runs from its SIO FIFO interrupt
+ * @remarks The pass is flagged before its word is pushed, so with nothing pending the word is
+ *          someone else's and goes to the handler this one replaced.
+ *
+ */
+void __fft_helper_irq() {
+    uint32_t pending = __atomic_load_n(&fft_helper_pending, __ATOMIC_ACQUIRE);
+    if (pending == 0) {
+        if (fft_helper_chained) {
+            fft_helper_chained();
+            return;
+        }
+        while (multicore_fifo_rvalid()) multicore_fifo_pop_blocking();
+        multicore_fifo_clear_irq();
+        return;
+    }
+
+    multicore_fifo_pop_blocking();
+    fft_job.run((fft_pass_t)(pending - 1), 1, 2);
+    __atomic_store_n(&fft_helper_pending, 0, __ATOMIC_RELEASE);
+    multicore_fifo_clear_irq();
+}
+
 /**
  * @brief Generates a LUT based on a reference A4 frequency
  * @remarks Math based on https://pages.mtu.edu/~suits/NoteFreqCalcs.html
@@ -282,19 +621,51 @@ fix15 do_fft() {
 const void __populate_freq_lut(uint16_t tune_a) {
     for (uint8_t i = 0; i < 12 * NUM_OCTAVES; i++) {
         // We tune to A4, so C0 is 4*12 + 9 below that
-        FREQ_LUT[i] = (double)tune_a * pow(FREQ2OCTAVE_CONSTANT, i - (4 * 12 + 9));
+        FREQ_LUT[i] = (double)tune_a * NOTE_RATIOS.values[i];
     }
+
+    // Everything freq2note() needs from the LUT, worked out once per reference change
+    freq_log2_c0 = tune_a ? (int64_t)llround(log2(FREQ_LUT[0]) * (1LL << 30)) : 0;
 }
 
 /**
  * @brief Determines the closest note to the given frequency, plus the percent deviation
+ * @remarks Fixed-point take on freq2note_reference(). The distance from C0 comes straight
+ *          out of log2(freq) in Q30 semitones, so there's no scan of FREQ_LUT and no
+ *          soft-float. Ties go the reference's way, up to the higher note and away from zero
+ *          on the cents, and whatever table_log2() is off by can only move an input sitting
+ *          right on a rounding boundary, so the cents are within one of the reference's.
  *
  * @param freq input frequency
- * @param note_index number of half-steps above C0
+ * @param note_index number of half-steps above C0, left alone outside C0..B7
  * @param cents_deviation percent deviation from closest note (max val is ±50)
  */
 void freq2note(fix15 freq, uint8_t *note_index, int8_t *cents_deviation) {
-    char msg[64];
+    if (freq <= 0 || tune_a_value == 0) return;
+
+    // Semitones above C0 in Q30, from C0 up to B7 like the reference's scan of FREQ_LUT
+    int64_t semis = (table_log2(freq) - (15LL << 30) - freq_log2_c0) * 12;
+    if (semis < 0 || semis >= ((12LL * NUM_OCTAVES - 1) << 30)) return;
+
+    // Nearest note with ties going up, and the distance from it in Q30 cents, positive when the input is flat
+    int64_t note  = (semis + (1LL << 29)) >> 30;
+    int64_t cents = ((note << 30) - semis) * 100;
+    int64_t mag   = cents < 0 ? -cents : cents;
+
+    *note_index      = (uint8_t)note;
+    *cents_deviation = (int8_t)((cents < 0 ? -1 : 1) * ((mag + (1LL << 29)) >> 30));
+}
+
+/**
+ * @brief Determines the closest note to the given frequency, plus the percent deviation
+ * @note Double precision original of freq2note(), kept for the host benchmark to check it
+ *       against. Outside C0..B7 the outputs are left alone.
+ *
+ * @param freq input frequency
+ * @param note_index number of half-steps above C0
+ * @param cents_deviation percent deviation from closest note (max val is ±50)
+ */
+void freq2note_reference(fix15 freq, uint8_t *note_index, int8_t *cents_deviation) {
     float input_float = fix2float15(freq);
     for (uint8_t i = 0; i < 12 * NUM_OCTAVES; i++) {
         if (input_float < FREQ_LUT[i]) {
@@ -324,64 +695,124 @@ uint32_t index2freq(uint8_t index) {
     return (uint32_t)FREQ_LUT[index];
 }
 
-const fix15 __average(fix15 *buf, uint8_t count) {
-    fix15 sum    = 0;
-    uint8_t omit = 0;
-    for (int i = 0; i < count; i++) {
-        if (buf[i] == 0) {
-            omit++;
-            continue;
-        } else {
-            sum += buf[i];
-        }
-    }
-    return multiply_fix15(sum, float2fix15((float)1 / (count - omit)));
+/**
+ * @brief Exact frequency of a note
+ *
+ * @param index number of half-steps above C0
+ * @return fix15 frequency in Hz
+ */
+fix15 note_frequency(uint8_t index) {
+    return float2fix15(FREQ_LUT[index]);
 }
 
-const fix15 __variance(fix15 *buf, uint8_t count, fix15 avg) {
-    fix15 stddev = 0;
-    uint8_t omit = 0;
-    for (int i = 0; i < count; i++) {
-        if (buf[i] == 0) {
-            omit++;
-            continue;
-        } else {
-            stddev += multiply_fix15((buf[i] - avg), (buf[i] - avg));
-        }
-    }
-    return multiply_fix15(stddev, float2fix15((float)1 / (count - omit)));
+/**
+ * @brief Changes what frequency A5 is referred to
+ *
+ * @param new_center new center frequency
+ */
+void change_fft_center(uint16_t new_center) {
+    tune_a_value = new_center;
+    __populate_freq_lut(tune_a_value);
 }
 
-const fix15 __median(fix15 *arr, uint8_t count) {
-    fix15 tmp[ROLLING_ITEMS];
-    memcpy(tmp, arr, ROLLING_ITEMS * sizeof(fix15));
+/**
+ * @brief Drops a part-filled frame or sliding history, the next frame starts from scratch
+ */
+static void __restart_frame() {
+    frame_fill   = 0;
+    frame_errors = 0;
+    hop_fill     = 0;
+    history_head = 0;
+}
 
-    // Sort
-    for (uint8_t i = 1; i <= count - 1; i++) {
-        for (uint8_t j = 1; j <= count - i; j++) {
-            if (arr[j] <= arr[j + 1]) {
-                fix15 t    = tmp[j];
-                tmp[j]     = tmp[j + 1];
-                tmp[j + 1] = t;
-            } else {
-                continue;
-            }
-        }
+/**
+ * @brief Takes the next capture from the ring, or from mic_dma_handler() without one
+ *
+ * @param stamp set to when it landed
+ * @return uint16_t* capture_depth samples, NULL if there's nothing new
+ */
+static uint16_t *__take_capture(uint32_t *stamp) {
+    if (capture_source == NULL) {
+        // transfer complete, so we reset the input buffer
+        uint16_t *capture = data_input;
+        *stamp            = data_stamp;
+        data_input        = NULL;
+        return capture;
     }
 
-    if (count % 2 == 0) {
-        return (tmp[count / 2] + tmp[count / 2 + 1]) >> 1;
-    } else {
-        return tmp[count / 2 + 1];
-    }
+    int8_t slot = capture_ring_acquire(capture_source, stamp);
+    if (slot == CAPTURE_NONE) return NULL;
+    capture_held = slot;
+    return capture_source->buffers[slot];
 }
 
 /**
- * @brief Changes what frequency A5 is referred to
- *
- * @param new_center new center frequency
+ * @brief Gives the held capture back to the ring, if there is one
  */
-void change_fft_center(uint16_t new_center) {
-    tune_a_value = new_center;
-    __populate_freq_lut(tune_a_value);
-}
\ No newline at end of file
+static void __release_capture() {
+    if (capture_source == NULL) return;
+    capture_ring_release(capture_source, capture_held);
+    capture_held = CAPTURE_NONE;
+}
+
+/**
+ * @brief fft_next_frame() with a hop set: feeds captures into the sliding history until
+ *        fft_hop new samples are in, then hands out the newest frame_depth of them
+ * @remarks Like the decimator's delay line, each sample is stored twice, frame_depth apart,
+ *          so the window is always contiguous and is read in place. A capture is only fed
+ *          in as far as the next window needs, the rest waits for the next call, so a
+ *          capture with more than a hop in it gives one window per call.
+ */
+static uint16_t *__next_window(uint16_t *errors) {
+    uint16_t *history = frame_buffer;
+    while (frame_fill < frame_depth || hop_fill < fft_hop) {
+        if (stream_capture == NULL) {
+            stream_capture = __take_capture(&stream_stamp);
+            stream_offset  = 0;
+            if (stream_capture == NULL) return NULL;
+        }
+
+        // As many as the window still needs, without running off the history's first copy
+        uint16_t wanted = frame_depth - frame_fill;
+        if (wanted < fft_hop - hop_fill) wanted = fft_hop - hop_fill;
+        uint16_t room = frame_depth - history_head;
+        if (wanted > room) wanted = room;
+
+        uint16_t left  = capture_depth - stream_offset;
+        uint16_t count = 0;
+        if (fft_decimation == 1) {
+            // Flags are counted and cleared on the way in, as decimate() does, so a bad sample
+            // counts once rather than once for every window it falls in
+            count = wanted < left ? wanted : left;
+            for (uint16_t i = 0; i < count; i++) {
+                uint16_t raw = stream_capture[stream_offset + i];
+                frame_errors += raw >> 15;
+                history[history_head + i] = raw & 0x7FFF;
+            }
+            stream_offset += count;
+        } else {
+            // wanted * D inputs give exactly wanted outputs whatever phase the decimator is at
+            uint32_t inputs = (uint32_t)wanted * fft_decimation;
+            if (inputs > left) inputs = left;
+            count = decimate(stream_capture + stream_offset, inputs, history + history_head, room, &frame_errors);
+            stream_offset += inputs;
+        }
+        memcpy(history + history_head + frame_depth, history + history_head, count * sizeof(uint16_t));
+        history_head = (history_head + count) & (frame_depth - 1);
+        frame_fill   = frame_fill + count < frame_depth ? frame_fill + count : frame_depth;
+        hop_fill += count;
+
+        if (stream_offset == capture_depth) {
+            // All of it is in the history now
+            __release_capture();
+            stream_capture = NULL;
+        }
+    }
+
+    *errors += frame_errors;
+    frame_errors = 0;
+    hop_fill     = 0;
+    last_frame   = history + history_head;
+    frame_stamp  = stream_stamp;
+    return last_frame;
+}
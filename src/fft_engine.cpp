@@ -0,0 +1,429 @@
+#include "fft_engine.h"
+
+#include "decimate.h"
+
+static_assert(FFT_MAX_BITS >= FFT_MIN_BITS && FFT_MAX_BITS <= 14, "No FFT instantiations for this FFT_MAX_BITS");
+
+/**
+ * @brief Turns a frame of raw ADC readings into windowed FFT input in one pass
+ * @remarks Error flags are masked off in a register rather than in the frame, and
+ *          window[i] * x is exactly multiply_fix15(window[i], int2fix15(x)). Samples are
+ *          centred on ADC_MIDSCALE first so the bias doesn't leak a DC lobe into the low
+ *          bins, which the wider windows would otherwise mistake for a peak.
+ *          Real input mode writes even samples to re and odd samples to im, which is the
+ *          packed layout the N/2 point FFT wants, so there's no separate packing pass.
+ *
+ * @param frame LENGTH raw readings, bit 15 is the ADC error flag
+ * @param x FFT input, interleaved complex
+ * @param mode FFT_INPUT_REAL or FFT_INPUT_COMPLEX
+ * @return uint16_t number of samples with the error flag set
+ */
+template <uint8_t Bits, uint8_t Frac>
+uint16_t fft_engine<Bits, Frac>::ingest(const uint16_t *frame, complex15 *x, fft_input_t mode) {
+    const fix15 *window = dsp_arena.window;
+    uint16_t errors     = 0;
+    if (mode == FFT_INPUT_REAL) {
+        for (uint16_t i = 0; i < LENGTH / 2; i++) {
+            uint16_t even = frame[2 * i];
+            uint16_t odd  = frame[2 * i + 1];
+            errors += (even >> 15) + (odd >> 15);
+            x[i].re = from_q15(window[2 * i] * ((fix15)(even & 0x7FFF) - ADC_MIDSCALE));
+            x[i].im = from_q15(window[2 * i + 1] * ((fix15)(odd & 0x7FFF) - ADC_MIDSCALE));
+        }
+    } else {
+        for (uint16_t i = 0; i < LENGTH; i++) {
+            uint16_t sample = frame[i];
+            errors += sample >> 15;
+            x[i].re = from_q15(window[i] * ((fix15)(sample & 0x7FFF) - ADC_MIDSCALE));
+            x[i].im = 0;
+        }
+    }
+    return errors;
+}
+
+/**
+ * @brief In-place FFT of an ingested frame, output is scaled by 1/LENGTH
+ * @note Real input leaves bins 0..LENGTH/2 in x, complex input leaves all LENGTH bins
+ *
+ * @param x interleaved complex data, in natural order
+ * @param mode FFT_INPUT_REAL or FFT_INPUT_COMPLEX, must match ingest()
+ * @param kernel FFT_KERNEL_RADIX4 or FFT_KERNEL_RADIX2
+ */
+template <uint8_t Bits, uint8_t Frac>
+void fft_engine<Bits, Frac>::transform(complex15 *x, fft_input_t mode, fft_kernel_t kernel) {
+    if (mode == FFT_INPUT_REAL) {
+        if (kernel == FFT_KERNEL_RADIX4) {
+            radix4<Bits - 1>(x);
+        } else {
+            radix2<Bits - 1>(x);
+        }
+
+        // Untangle the packed spectrum into bins 0..N/2
+        FFT_STAGE_MARK(FFT_STAGE_SPLIT);
+        real_split(x);
+    } else if (kernel == FFT_KERNEL_RADIX4) {
+        radix4<Bits>(x);
+    } else {
+        radix2<Bits>(x);
+    }
+}
+
+/**
+ * @brief Finds the strongest local maximum of the real part below Nyquist
+ *
+ * @param x spectrum from transform()
+ * @param max_val set to the peak height in fix15, 0 if there's no peak
+ * @return uint16_t bin of the peak, 0 if there's no peak
+ */
+template <uint8_t Bits, uint8_t Frac> uint16_t fft_engine<Bits, Frac>::peak(const complex15 *x, fix15 *max_val) {
+    fix15 max_re   = 0;
+    uint16_t i_max = 0;
+    for (uint16_t i = 1; i < LENGTH / 2; i++) {
+        if ((x[i].re > x[i - 1].re) && x[i].re > x[i + 1].re) {
+            if (x[i].re > max_re) {
+                max_re = x[i].re;
+                i_max  = i;
+            }
+        }
+    }
+
+    *max_val = max_re << (15 - Frac);
+    return i_max;
+}
+
+/**
+ * @brief In-place radix-2 complex FFT of 2^N points, output is scaled by 1/2^N
+ *
+ * @param x interleaved complex data, in natural order
+ */
+template <uint8_t Bits, uint8_t Frac> template <uint8_t N> void fft_engine<Bits, Frac>::radix2(complex15 *x) {
+    const uint16_t length = 1 << N;
+
+    // Step 1: bit reversal
+    // Here, we reverse the order of the bits of the indices
+    FFT_STAGE_MARK(FFT_STAGE_BITREVERSE);
+    for (uint16_t i = 1; i < length - 1; i++) {
+        // We can skip the first and last indices because 0x0000 and 0xFFFF flipped is just itself
+        // Bit reversal from https://graphics.stanford.edu/~seander/bithacks.html#ReverseParallel
+        uint16_t v = i; // 16-bit word to reverse bit order
+
+        // swap odd and even bits
+        v = ((v >> 1) & 0x5555) | ((v & 0x5555) << 1);
+        // swap consecutive pairs
+        v = ((v >> 2) & 0x3333) | ((v & 0x3333) << 2);
+        // swap nibbles ...
+        v = ((v >> 4) & 0x0F0F) | ((v & 0x0F0F) << 4);
+        // swap bytes
+        v = ((v >> 8) & 0x00FF) | ((v & 0x00FF) << 8);
+        // Adjust for total number of samples
+        v >>= (16 - N);
+
+        // Don't swap what's already been swapped
+        if (v <= i) continue;
+
+        // Swap bit-reversed indices
+        complex15 tmp = x[i];
+        x[i]          = x[v];
+        x[v]          = tmp;
+    }
+
+    // Step 2: FFT (Danielson-Lanczos)
+    FFT_STAGE_MARK(FFT_STAGE_BUTTERFLY);
+    uint16_t fft_len  = 1;
+    uint16_t fft_bits = Bits - 1; // twiddles always index the full 2^Bits circle
+    while (fft_len < length) {
+        // Determine new FFT length
+        uint16_t new_fft_len = fft_len << 1;
+
+        // Combine elements in FFTs
+        for (uint16_t i = 0; i < fft_len; i++) {
+            // Get trig values for this element (0.5*cos/sin(sample number))
+            uint32_t bt    = i << fft_bits;
+            fix15 sin_term = -twiddle_sin(bt);
+            fix15 cos_term = twiddle_cos(bt);
+            sin_term >>= 1;
+            cos_term >>= 1;
+
+            for (uint16_t k = i; k < length; k += new_fft_len) {
+                uint32_t bn = k + fft_len;
+
+                fix15 real = mul(cos_term, x[bn].re) - mul(sin_term, x[bn].im);
+                fix15 imag = mul(cos_term, x[bn].im) + mul(sin_term, x[bn].re);
+
+                fix15 real_tmp = x[k].re >> 1;
+                fix15 imag_tmp = x[k].im >> 1;
+
+                x[bn].re = real_tmp - real;
+                x[bn].im = imag_tmp - imag;
+                x[k].re  = real_tmp + real;
+                x[k].im  = imag_tmp + imag;
+            }
+        }
+        fft_bits--;
+        fft_len = new_fft_len;
+    }
+}
+
+/**
+ * @brief In-place radix-4 complex FFT of 2^N points, output is scaled by 1/2^N
+ * @remarks Runs on radix-2 bit-reversed input, so each stage merges four length L
+ *          sub-FFTs as X[k] = A0 + W^2k A1 + W^k A2 + W^3k A3. That takes three twiddle
+ *          multiplies per four points instead of four, and each one is done with three
+ *          real multiplies. Odd bit counts start with a single twiddle-free radix-2 stage.
+ *          Every pass goes through fft_run_pass(), which may split it with the helper core.
+ *
+ * @param x interleaved complex data, in natural order
+ */
+template <uint8_t Bits, uint8_t Frac> template <uint8_t N> void fft_engine<Bits, Frac>::radix4(complex15 *x) {
+    fft_job.data = x;
+    fft_job.run  = pass<N>;
+
+    // Step 1: bit reversal from the table built in fft_init()
+    FFT_STAGE_MARK(FFT_STAGE_BITREVERSE);
+    fft_run_pass(FFT_PASS_BITREVERSE);
+
+    // Step 2: FFT (radix-4 Danielson-Lanczos)
+    FFT_STAGE_MARK(FFT_STAGE_BUTTERFLY);
+    fft_job.fft_len = 1;
+    if (N & 1) {
+        fft_run_pass(FFT_PASS_RADIX2);
+        fft_job.fft_len = 2;
+    }
+
+    // Twiddles for W_4L^k sit every 2^Bits / 4L entries around the circle
+    fft_job.fft_bits = Bits - 2 - (N & 1);
+    while (fft_job.fft_len < (1 << N)) {
+        fft_run_pass(FFT_PASS_RADIX4);
+        fft_job.fft_bits -= 2;
+        fft_job.fft_len <<= 2;
+    }
+}
+
+/**
+ * @brief Runs one share of a radix-4 FFT pass on fft_job
+ * @note Shares touch disjoint points, so they can run concurrently without locking
+ *
+ * @param pass which pass of the transform
+ * @param part share to run, 0 to parts - 1
+ * @param parts number of shares the pass is split into
+ */
+template <uint8_t Bits, uint8_t Frac>
+template <uint8_t N>
+void fft_engine<Bits, Frac>::pass(fft_pass_t pass, uint8_t part, uint8_t parts) {
+    const uint16_t length = 1 << N;
+    complex15 *x          = fft_job.data;
+
+    if (pass == FFT_PASS_BITREVERSE) {
+        // The table is FFT_MAX_BITS deep, shorter transforms shift it down.
+        // Each swap belongs to the smaller index, so splitting on it never swaps twice
+        const uint16_t *bit_reverse = dsp_arena.bit_reverse;
+        uint16_t lo                 = ((uint32_t)length * part) / parts;
+        uint16_t hi                 = ((uint32_t)length * (part + 1)) / parts;
+        if (lo < 1) lo = 1;
+        if (hi > length - 1) hi = length - 1;
+        for (uint16_t i = lo; i < hi; i++) {
+            uint16_t v = bit_reverse[i] >> (FFT_MAX_BITS - N);
+            if (v <= i) continue;
+
+            complex15 tmp = x[i];
+            x[i]          = x[v];
+            x[v]          = tmp;
+        }
+    } else if (pass == FFT_PASS_RADIX2) {
+        uint16_t pairs = length >> 1;
+        uint16_t lo    = ((uint32_t)pairs * part) / parts;
+        uint16_t hi    = ((uint32_t)pairs * (part + 1)) / parts;
+        for (uint16_t k = lo << 1; k < hi << 1; k += 2) {
+            fix15 real_tmp = x[k + 1].re;
+            fix15 imag_tmp = x[k + 1].im;
+            x[k + 1].re    = (x[k].re - real_tmp) >> 1;
+            x[k + 1].im    = (x[k].im - imag_tmp) >> 1;
+            x[k].re        = (x[k].re + real_tmp) >> 1;
+            x[k].im        = (x[k].im + imag_tmp) >> 1;
+        }
+    } else {
+        uint16_t fft_len     = fft_job.fft_len;
+        uint16_t fft_bits    = fft_job.fft_bits;
+        uint16_t new_fft_len = fft_len << 2;
+
+        // Early stages have many groups sharing one twiddle, late stages few groups with many
+        // twiddles, so split whichever loop is longer
+        uint16_t groups = length / new_fft_len;
+        uint16_t i_lo = 0, i_hi = fft_len, g_lo = 0, g_hi = groups;
+        if (fft_len >= groups) {
+            i_lo = ((uint32_t)fft_len * part) / parts;
+            i_hi = ((uint32_t)fft_len * (part + 1)) / parts;
+        } else {
+            g_lo = ((uint32_t)groups * part) / parts;
+            g_hi = ((uint32_t)groups * (part + 1)) / parts;
+        }
+
+        for (uint16_t i = i_lo; i < i_hi; i++) {
+            // Twiddle factors for k, 2k and 3k, pre-summed for the 3 multiply complex product
+            fix15 cos1 = 0, sum1 = 0, diff1 = 0;
+            fix15 cos2 = 0, sum2 = 0, diff2 = 0;
+            fix15 cos3 = 0, sum3 = 0, diff3 = 0;
+            if (i != 0) {
+                uint32_t bt1 = i << fft_bits;
+                uint32_t bt2 = bt1 << 1;
+                uint32_t bt3 = bt1 + bt2;
+
+                cos1  = twiddle_cos(bt1);
+                sum1  = cos1 - twiddle_sin(bt1);
+                diff1 = -twiddle_sin(bt1) - cos1;
+                cos2  = twiddle_cos(bt2);
+                sum2  = cos2 - twiddle_sin(bt2);
+                diff2 = -twiddle_sin(bt2) - cos2;
+                cos3  = twiddle_cos(bt3);
+                sum3  = cos3 - twiddle_sin(bt3);
+                diff3 = -twiddle_sin(bt3) - cos3;
+            }
+
+            for (uint32_t k = i + (uint32_t)g_lo * new_fft_len; k < (uint32_t)g_hi * new_fft_len; k += new_fft_len) {
+                uint16_t k1 = k + fft_len;
+                uint16_t k2 = k1 + fft_len;
+                uint16_t k3 = k2 + fft_len;
+
+                fix15 a1_re = x[k1].re, a1_im = x[k1].im;
+                fix15 a2_re = x[k2].re, a2_im = x[k2].im;
+                fix15 a3_re = x[k3].re, a3_im = x[k3].im;
+                if (i != 0) {
+                    // (x + jy)(c + jd) = (c(x + y) - y(c + d)) + j(c(x + y) + x(d - c))
+                    fix15 t = mul(cos2, a1_re + a1_im);
+                    a1_re   = t - mul(sum2, a1_im);
+                    a1_im   = t + mul(diff2, x[k1].re);
+                    t       = mul(cos1, a2_re + a2_im);
+                    a2_re   = t - mul(sum1, a2_im);
+                    a2_im   = t + mul(diff1, x[k2].re);
+                    t       = mul(cos3, a3_re + a3_im);
+                    a3_re   = t - mul(sum3, a3_im);
+                    a3_im   = t + mul(diff3, x[k3].re);
+                }
+
+                fix15 t0_re = x[k].re + a1_re, t0_im = x[k].im + a1_im;
+                fix15 t1_re = x[k].re - a1_re, t1_im = x[k].im - a1_im;
+                fix15 t2_re = a2_re + a3_re, t2_im = a2_im + a3_im;
+                fix15 t3_re = a2_re - a3_re, t3_im = a2_im - a3_im;
+
+                x[k].re  = (t0_re + t2_re) >> 2;
+                x[k].im  = (t0_im + t2_im) >> 2;
+                x[k1].re = (t1_re + t3_im) >> 2;
+                x[k1].im = (t1_im - t3_re) >> 2;
+                x[k2].re = (t0_re - t2_re) >> 2;
+                x[k2].im = (t0_im - t2_im) >> 2;
+                x[k3].re = (t1_re - t3_im) >> 2;
+                x[k3].im = (t1_im + t3_re) >> 2;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Turns the N/2 point FFT of packed real data into bins 0..N/2 of the N point FFT
+ * @remarks X[k] = (Z[k] + Z*[N/2-k]) / 2 + W^k (Z[k] - Z*[N/2-k]) / 2j, scaled to match the complex FFT
+ *
+ * @param x packed FFT, LENGTH / 2 + 1 long
+ */
+template <uint8_t Bits, uint8_t Frac> void fft_engine<Bits, Frac>::real_split(complex15 *x) {
+    const uint16_t half = LENGTH / 2;
+
+    // DC and Nyquist are both purely real and fall out of bin 0
+    fix15 dc   = x[0].re;
+    x[0].re    = (dc + x[0].im) >> 1;
+    x[half].re = (dc - x[0].im) >> 1;
+    x[0].im    = 0;
+    x[half].im = 0;
+
+    // Bins k and N/2-k are built from the same pair of inputs, so do them together
+    for (uint16_t k = 1; k <= half / 2; k++) {
+        uint16_t j = half - k;
+
+        // Even and odd sample spectra
+        fix15 even_re = (x[k].re + x[j].re) >> 1;
+        fix15 even_im = (x[k].im - x[j].im) >> 1;
+        fix15 odd_re  = (x[k].im + x[j].im) >> 1;
+        fix15 odd_im  = (x[j].re - x[k].re) >> 1;
+
+        // Rotate the odd spectrum by the twiddle for bin k
+        fix15 sin_term = -twiddle_sin(k);
+        fix15 cos_term = twiddle_cos(k);
+        fix15 rot_re   = mul(cos_term, odd_re) - mul(sin_term, odd_im);
+        fix15 rot_im   = mul(cos_term, odd_im) + mul(sin_term, odd_re);
+
+        // X[k] = (E + WO) / 2 and X[N/2-k] = conj(E - WO) / 2
+        x[k].re = (even_re + rot_re) >> 1;
+        x[k].im = (even_im + rot_im) >> 1;
+        x[j].re = (even_re - rot_re) >> 1;
+        x[j].im = (rot_im - even_im) >> 1;
+    }
+}
+
+template <uint8_t Bits, uint8_t Frac>
+const fft_ops_t fft_engine<Bits, Frac>::ops = {Bits, Frac, ingest, transform, peak};
+
+// Every size the DSP arena has room for is compiled in, so fft_set_size() never has to fall back
+template class fft_engine<10, FFT_FRAC>;
+template class fft_engine<10, FFT_ALT_FRAC>;
+#if FFT_MAX_BITS >= 11
+template class fft_engine<11, FFT_FRAC>;
+template class fft_engine<11, FFT_ALT_FRAC>;
+#endif
+#if FFT_MAX_BITS >= 12
+template class fft_engine<12, FFT_FRAC>;
+template class fft_engine<12, FFT_ALT_FRAC>;
+#endif
+#if FFT_MAX_BITS >= 13
+template class fft_engine<13, FFT_FRAC>;
+template class fft_engine<13, FFT_ALT_FRAC>;
+#endif
+#if FFT_MAX_BITS >= 14
+template class fft_engine<14, FFT_FRAC>;
+template class fft_engine<14, FFT_ALT_FRAC>;
+#endif
+
+// Indexed by format, FFT_FRAC then FFT_ALT_FRAC, then by size
+const fft_ops_t *const FFT_ENGINES[2][FFT_MAX_BITS - FFT_MIN_BITS + 1] = {
+    {
+        &fft_engine<10, FFT_FRAC>::ops,
+#if FFT_MAX_BITS >= 11
+        &fft_engine<11, FFT_FRAC>::ops,
+#endif
+#if FFT_MAX_BITS >= 12
+        &fft_engine<12, FFT_FRAC>::ops,
+#endif
+#if FFT_MAX_BITS >= 13
+        &fft_engine<13, FFT_FRAC>::ops,
+#endif
+#if FFT_MAX_BITS >= 14
+        &fft_engine<14, FFT_FRAC>::ops,
+#endif
+    },
+    {
+        &fft_engine<10, FFT_ALT_FRAC>::ops,
+#if FFT_MAX_BITS >= 11
+        &fft_engine<11, FFT_ALT_FRAC>::ops,
+#endif
+#if FFT_MAX_BITS >= 12
+        &fft_engine<12, FFT_ALT_FRAC>::ops,
+#endif
+#if FFT_MAX_BITS >= 13
+        &fft_engine<13, FFT_ALT_FRAC>::ops,
+#endif
+#if FFT_MAX_BITS >= 14
+        &fft_engine<14, FFT_ALT_FRAC>::ops,
+#endif
+    },
+};
+
+/**
+ * @brief Looks up the compiled FFT for a frame size and fixed-point format
+ *
+ * @param bits log2 of the frame length
+ * @param frac fractional bits, FFT_FRAC or FFT_ALT_FRAC
+ * @return const fft_ops_t* that FFT, NULL if it isn't compiled in
+ */
+const fft_ops_t *fft_engine_ops(uint8_t bits, uint8_t frac) {
+    if (bits < FFT_MIN_BITS || bits > FFT_MAX_BITS) return NULL;
+    if (frac != FFT_FRAC && frac != FFT_ALT_FRAC) return NULL;
+    return FFT_ENGINES[frac == FFT_ALT_FRAC][bits - FFT_MIN_BITS];
+}
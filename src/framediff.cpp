@@ -0,0 +1,78 @@
+#include "framediff.h"
+
+// Private defs
+static inline bool __tile_dirty(const framediff_t *diff, const uint8_t *buffer, uint8_t tx, uint8_t ty);
+
+/**
+ * @brief Forgets what the display shows, so the next flush sends every tile
+ * @note Call after anything else has drawn to the display, e.g. a fresh begin()
+ *
+ * @param diff diff state
+ */
+void framediff_invalidate(framediff_t *diff) {
+    diff->stale = true;
+}
+
+/**
+ * @brief Takes back the last flush, so the next one sends its tiles again
+ * @note Call when the transfer it went into was dropped before reaching the display,
+ *       e.g. a queued stream replaced by a newer frame
+ *
+ * @param diff diff state
+ */
+void framediff_retract(framediff_t *diff) {
+    for (uint8_t ty = 0; ty < DISPLAY_TILE_ROWS; ty++) diff->resend[ty] |= diff->flushed[ty];
+}
+
+/**
+ * @brief Sends the tiles of a frame that differ from the last one sent
+ * @remarks Each tile row is scanned for runs of changed tiles, and runs split by no more
+ *          than FRAMEDIFF_GAP unchanged tiles go out as one transfer. A stale diff sends
+ *          each tile row whole, and tiles framediff_retract() took back go out as changed.
+ *
+ * @param diff diff state
+ * @param buffer frame to send, DISPLAY_BUFFER_SIZE bytes
+ * @param send called once per run of tiles
+ * @return uint16_t framebuffer bytes sent
+ */
+uint16_t framediff_flush(framediff_t *diff, const uint8_t *buffer, framediff_send_t send) {
+    uint16_t bytes = 0;
+
+    for (uint8_t ty = 0; ty < DISPLAY_TILE_ROWS; ty++) {
+        uint16_t flushed = 0;
+        uint8_t tx       = 0;
+        while (tx < DISPLAY_TILE_COLS) {
+            if (!diff->stale && !__tile_dirty(diff, buffer, tx, ty)) {
+                tx++;
+                continue;
+            }
+
+            // Grow the run while another changed tile is within reach
+            uint8_t end = tx + 1;
+            for (uint8_t t = end; t < DISPLAY_TILE_COLS && t - end < FRAMEDIFF_GAP + 1; t++) {
+                if (diff->stale || __tile_dirty(diff, buffer, t, ty)) end = t + 1;
+            }
+
+            uint16_t offset = (ty * DISPLAY_TILE_COLS + tx) * 8;
+            memcpy(diff->sent + offset, buffer + offset, (end - tx) * 8);
+            send(tx, ty, end - tx);
+            bytes += (end - tx) * 8;
+            flushed |= ((1 << (end - tx)) - 1) << tx;
+            tx = end;
+        }
+        diff->flushed[ty] = flushed;
+        diff->resend[ty]  = 0;
+    }
+
+    diff->stale = false;
+    return bytes;
+}
+
+/**
+ * @brief Whether tile (tx, ty) differs from what was last sent, or was retracted since
+ */
+static inline bool __tile_dirty(const framediff_t *diff, const uint8_t *buffer, uint8_t tx, uint8_t ty) {
+    if (diff->resend[ty] & (1 << tx)) return true;
+    uint16_t offset = (ty * DISPLAY_TILE_COLS + tx) * 8;
+    return memcmp(diff->sent + offset, buffer + offset, 8) != 0;
+}
@@ -0,0 +1,155 @@
+#include "glyphs.h"
+
+// Private defs
+static inline bool __pixel(const uint8_t *buffer, uint8_t x, uint8_t y);
+static void __blit(uint8_t *buffer, const glyph_t *glyph, int16_t x, int16_t y);
+
+/**
+ * @brief Caches a glyph that has just been drawn on its own into a cleared framebuffer
+ * @remarks The box is trimmed to the pixels that are set, so blank margins cost nothing
+ *          to draw later.
+ *
+ * @param font cache to add it to
+ * @param c character, must be in GLYPH_CHARSET
+ * @param buffer framebuffer the glyph was drawn into, DISPLAY_BUFFER_SIZE bytes
+ * @param x drawing origin
+ * @param y drawing origin, on the baseline
+ * @param advance origin to the next glyph's origin
+ * @param extent origin to the right edge of the glyph
+ */
+void glyph_capture(glyph_font_t *font,
+                   char c,
+                   const uint8_t *buffer,
+                   uint8_t x,
+                   uint8_t y,
+                   uint8_t advance,
+                   uint8_t extent) {
+    const char *found = strchr(GLYPH_CHARSET, c);
+    if (c == '\0' || found == NULL) { fatal_error("Glyph not in the cached set"); }
+    glyph_t *glyph = &font->glyphs[found - GLYPH_CHARSET];
+
+    uint8_t left = DISPLAY_WIDTH, right = 0, top = DISPLAY_HEIGHT, bottom = 0;
+    for (uint8_t row = 0; row < DISPLAY_HEIGHT; row++) {
+        for (uint8_t col = 0; col < DISPLAY_WIDTH; col++) {
+            if (!__pixel(buffer, col, row)) continue;
+            if (col < left) left = col;
+            if (col > right) right = col;
+            if (row < top) top = row;
+            bottom = row;
+        }
+    }
+
+    glyph->advance = advance;
+    glyph->extent  = extent;
+    glyph->w = glyph->h = 0;
+    glyph->dx = glyph->dy = 0;
+    if (left > right) return; // blank, e.g. a space
+
+    glyph->w  = right - left + 1;
+    glyph->h  = bottom - top + 1;
+    glyph->dx = left - x;
+    glyph->dy = top - y;
+    if (glyph->w > GLYPH_MAX_WIDTH || glyph->h > GLYPH_MAX_PAGES * 8) { fatal_error("Glyph too large to cache"); }
+
+    memset(glyph->bits, 0, sizeof(glyph->bits));
+    for (uint8_t row = 0; row < glyph->h; row++) {
+        for (uint8_t col = 0; col < glyph->w; col++) {
+            if (__pixel(buffer, left + col, top + row)) glyph->bits[(row / 8) * glyph->w + col] |= 1 << (row % 8);
+        }
+    }
+}
+
+/**
+ * @brief Looks a character up in the cache
+ *
+ * @param font cache to look in
+ * @param c character
+ * @return const glyph_t* glyph, NULL if c isn't in GLYPH_CHARSET
+ */
+const glyph_t *glyph_find(const glyph_font_t *font, char c) {
+    const char *found = c == '\0' ? NULL : strchr(GLYPH_CHARSET, c);
+    return found == NULL ? NULL : &font->glyphs[found - GLYPH_CHARSET];
+}
+
+/**
+ * @brief Width of a string, the same as U8g2's getStrWidth()
+ * @remarks Every glyph but the last counts its advance, the last counts up to its right edge.
+ *
+ * @param font cache the string is drawn from
+ * @param str string, characters outside GLYPH_CHARSET count as nothing
+ * @return uint8_t width in pixels
+ */
+uint8_t glyph_width(const glyph_font_t *font, const char *str) {
+    uint8_t width = 0;
+    for (; *str != '\0'; str++) {
+        const glyph_t *glyph = glyph_find(font, *str);
+        if (glyph == NULL) continue;
+        width += (str[1] == '\0') ? glyph->extent : glyph->advance;
+    }
+    return width;
+}
+
+/**
+ * @brief Draws a string from the cache, like U8g2's drawStr() with font mode 0
+ * @note Each glyph's box is drawn solid, cleared where the glyph has no pixels, so text
+ *       stays readable over anything drawn before it
+ *
+ * @param buffer framebuffer, DISPLAY_BUFFER_SIZE bytes
+ * @param font cache to draw from
+ * @param x origin of the first glyph
+ * @param y baseline
+ * @param str string
+ * @return false, having drawn nothing, if a character isn't cached
+ */
+bool glyph_draw(uint8_t *buffer, const glyph_font_t *font, int16_t x, int16_t y, const char *str) {
+    for (const char *c = str; *c != '\0'; c++) {
+        if (glyph_find(font, *c) == NULL) return false;
+    }
+
+    for (; *str != '\0'; str++) {
+        const glyph_t *glyph = glyph_find(font, *str);
+        __blit(buffer, glyph, x + glyph->dx, y + glyph->dy);
+        x += glyph->advance;
+    }
+    return true;
+}
+
+/**
+ * @brief Whether a pixel is set in an SSD1306 layout framebuffer
+ */
+static inline bool __pixel(const uint8_t *buffer, uint8_t x, uint8_t y) {
+    return buffer[(y / 8) * DISPLAY_WIDTH + x] & (1 << (y % 8));
+}
+
+/**
+ * @brief Copies a glyph's box into the framebuffer with its top left at x, y
+ * @remarks A framebuffer byte is a column of 8 pixels, the same as a glyph byte, so each
+ *          glyph byte lands in at most two framebuffer bytes: shifted down into the page
+ *          it starts in and the rest into the page below. The box's rows in those bytes are
+ *          cleared before the glyph's pixels go in, as U8g2 font mode 0 paints the
+ *          background. Anything off screen is clipped.
+ */
+static void __blit(uint8_t *buffer, const glyph_t *glyph, int16_t x, int16_t y) {
+    int16_t page  = y >> 3; // floors for negative y too
+    uint8_t shift = y & 7;
+
+    for (uint8_t col = 0; col < glyph->w; col++) {
+        int16_t dest = x + col;
+        if (dest < 0 || dest >= DISPLAY_WIDTH) continue;
+
+        for (uint8_t p = 0; p < (glyph->h + 7) / 8; p++) {
+            uint8_t bits = glyph->bits[p * glyph->w + col];
+            uint8_t rows = glyph->h - p * 8 < 8 ? glyph->h - p * 8 : 8;
+            uint8_t mask = (1u << rows) - 1;
+            int16_t row  = page + p;
+            if (row >= 0 && row < DISPLAY_TILE_ROWS) {
+                uint8_t *out = &buffer[row * DISPLAY_WIDTH + dest];
+                *out         = (*out & ~(mask << shift)) | (bits << shift);
+            }
+            if (shift != 0 && row + 1 >= 0 && row + 1 < DISPLAY_TILE_ROWS) {
+                uint8_t *out = &buffer[(row + 1) * DISPLAY_WIDTH + dest];
+                *out         = (*out & ~(mask >> (8 - shift))) | (bits >> (8 - shift));
+            }
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#include "goertzel.h"
+
+// Private defs
+static void __goertzel_tune(uint8_t note_index, uint32_t rate);
+static inline int64_t __cents_ratio(fix15 cents);
+
+// Global variables
+uint32_t goertzel_step[GOERTZEL_BINS] = {0};
+uint8_t goertzel_note                 = 0xFF;
+fix15 goertzel_note_freq              = 0;
+uint32_t goertzel_rate                = 0;
+
+/**
+ * @brief Refines a pitch estimate with a narrow bank of single-bin DFTs around a note
+ * @remarks Each filter correlates the Hann windowed frame against a complex exponential
+ *          driven by a 32-bit phase accumulator. That is the same O(N) per bin as a
+ *          Goertzel recursion, but it stays exact at low frequencies where a Q15
+ *          2cos(w) coefficient can't resolve neighbouring filters.
+ *
+ * @param freq coarse frequency estimate, returned if the bank can't do better
+ * @param note_index nearest note to freq, half-steps above C0
+ * @return fix15 refined frequency
+ */
+fix15 goertzel_refine(fix15 freq, uint8_t note_index) {
+    uint16_t *frame = fft_last_frame();
+    if (frame == NULL || freq <= 0) return freq;
+
+    uint16_t length     = fft_frame_length();
+    const fix15 *window = fft_window_table();
+    uint32_t rate       = fft_frame_rate();
+
+    if (note_index != goertzel_note || note_frequency(note_index) != goertzel_note_freq || rate != goertzel_rate) {
+        __goertzel_tune(note_index, rate);
+    }
+
+    // One pass over the frame drives every filter
+    int64_t acc_re[GOERTZEL_BINS] = {0};
+    int64_t acc_im[GOERTZEL_BINS] = {0};
+    uint32_t phase[GOERTZEL_BINS] = {0};
+    for (uint16_t i = 0; i < length; i++) {
+        int32_t x = multiply_fix15(window[i], (int32_t)(frame[i] & 0x7FFF) - ADC_MIDSCALE);
+
+        // |x| stays under 2^13 even with flat-top's gain, so x * sin fits in 32 bits and only
+        // the sums need 64, which keeps software 64-bit multiplies off the M0+
+        for (uint8_t b = 0; b < GOERTZEL_BINS; b++) {
+            uint32_t idx = phase[b] >> (32 - FFT_MAX_BITS);
+            acc_re[b] += x * table_cos(idx);
+            acc_im[b] -= x * table_sin(idx);
+            phase[b] += goertzel_step[b];
+        }
+    }
+
+    // Power in each filter, scaled down so the square fits
+    int64_t power[GOERTZEL_BINS];
+    uint8_t peak = 0;
+    for (uint8_t b = 0; b < GOERTZEL_BINS; b++) {
+        int64_t re = acc_re[b] >> 20;
+        int64_t im = acc_im[b] >> 20;
+        power[b]   = re * re + im * im;
+        if (power[b] > power[peak]) peak = b;
+    }
+
+    // The tone is outside the bank, so trust the coarse estimate
+    if (peak == 0 || peak == GOERTZEL_BINS - 1 || power[peak] == 0) return freq;
+
+    // Parabolic interpolation on power relative to the peak
+    fix15 before = (fix15)((power[peak - 1] << 15) / power[peak]);
+    fix15 after  = (fix15)((power[peak + 1] << 15) / power[peak]);
+    fix15 curve  = before + after - int2fix15(2);
+    fix15 delta  = curve < 0 ? divide_fix15((before - after) >> 1, curve) : 0;
+    delta        = constrain(delta, -(int2fix15(1) >> 1), int2fix15(1) >> 1);
+
+    // Offset from the note in cents
+    fix15 cents = multiply_fix15(int2fix15(peak - GOERTZEL_BINS / 2) + delta, float2fix15(GOERTZEL_SPACING));
+    return (fix15)(((int64_t)goertzel_note_freq * __cents_ratio(cents)) >> 30);
+}
+
+/**
+ * @brief Recomputes the filter frequencies for a new note, reference or sample rate
+ *
+ * @param note_index note the bank is centred on
+ * @param rate frame sample rate
+ */
+static void __goertzel_tune(uint8_t note_index, uint32_t rate) {
+    goertzel_note      = note_index;
+    goertzel_note_freq = note_frequency(note_index);
+    goertzel_rate      = rate;
+
+    // Phase step of the note itself in Q32 cycles per sample, the bins are ratios of it
+    int64_t step = ((int64_t)goertzel_note_freq << 17) / rate;
+    for (uint8_t b = 0; b < GOERTZEL_BINS; b++) {
+        fix15 cents      = multiply_fix15(int2fix15((int)b - GOERTZEL_BINS / 2), float2fix15(GOERTZEL_SPACING));
+        goertzel_step[b] = (uint32_t)((step * __cents_ratio(cents)) >> 30);
+    }
+}
+
+/**
+ * @brief 2^(cents/1200) to second order, close enough across the bank's span
+ *
+ * @param cents offset in cents, within a semitone or so
+ * @return int64_t frequency ratio in Q30
+ */
+static inline int64_t __cents_ratio(fix15 cents) {
+    int64_t x = ((int64_t)cents * (int64_t)(0.69314718056 / 1200 * (1 << 30))) >> 15;
+    return (1LL << 30) + x + ((x * x) >> 31);
+}
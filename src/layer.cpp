@@ -0,0 +1,37 @@
+#include "layer.h"
+
+/**
+ * @brief Drops the cached background, so the next frame draws it again
+ *
+ * @param layer layer to clear
+ */
+void layer_invalidate(layer_t *layer) {
+    layer->cached = false;
+}
+
+/**
+ * @brief Starts a frame from the cached background
+ *
+ * @param layer layer to copy from
+ * @param buffer framebuffer, DISPLAY_BUFFER_SIZE bytes
+ * @param key background variant wanted
+ * @return true if it was cached and copied, false if the caller has to draw it and layer_save()
+ */
+bool layer_restore(const layer_t *layer, uint8_t *buffer, uint16_t key) {
+    if (!layer->cached || layer->key != key) return false;
+    memcpy(buffer, layer->bitmap, DISPLAY_BUFFER_SIZE);
+    return true;
+}
+
+/**
+ * @brief Caches a framebuffer holding only the background
+ *
+ * @param layer layer to fill
+ * @param buffer framebuffer, DISPLAY_BUFFER_SIZE bytes
+ * @param key background variant it was drawn for
+ */
+void layer_save(layer_t *layer, const uint8_t *buffer, uint16_t key) {
+    memcpy(layer->bitmap, buffer, DISPLAY_BUFFER_SIZE);
+    layer->key    = key;
+    layer->cached = true;
+}
@@ -0,0 +1,231 @@
+#include "log.h"
+
+// Private defs
+#define LOG_HEADER_BYTES 12 // sync, level and core, count, format address, timestamp
+
+static void __emit(const log_record_t *record);
+static void __format_arg(char *output, size_t size, const char *spec, char conversion, uintptr_t arg);
+
+// Global variables
+log_ring_t log_rings[LOG_CORES];
+uint32_t log_reported[LOG_CORES] = {0}; // drops already announced, only the drain touches it
+
+const char LOG_DROPPED[] = "log: %u records dropped on core %u";
+
+/**
+ * @brief Adds a record to the calling core's ring, dropping it if the ring is full
+ * @remarks Only reserving the slot needs interrupts off, and only on this core, so an IRQ
+ *          can't take the same one. The record is marked ready once it's filled in, and
+ *          the drain stops at the first one that isn't, which keeps them in order.
+ *
+ * @param level severity
+ * @param format printf format
+ * @param args packed arguments, see log_word()
+ * @param count number of arguments
+ */
+void log_write(error_t level, const char *format, const uintptr_t *args, uint8_t count) {
+    uint8_t core     = get_core_num();
+    log_ring_t *ring = &log_rings[core];
+
+    uint32_t status = save_and_disable_interrupts();
+    uint32_t head   = ring->head;
+    bool full       = head - ring->tail >= LOG_RING_SIZE;
+    if (full) {
+        ring->dropped++;
+    } else {
+        ring->head = head + 1;
+    }
+    restore_interrupts(status);
+    if (full) return;
+
+    uint32_t slot        = head % LOG_RING_SIZE;
+    log_record_t *record = &ring->records[slot];
+    record->format       = format;
+    record->time_us      = micros();
+    record->level        = level;
+    record->core         = core;
+    record->count        = count;
+    for (uint8_t i = 0; i < count; i++) record->args[i] = args[i];
+
+    __dmb(); // the record has to be visible before the drain sees it's ready
+    ring->ready[slot] = true;
+}
+
+/**
+ * @brief Takes the oldest finished record off a core's ring
+ *
+ * @param core ring to read
+ * @param record filled in with the record
+ * @return false if the ring is empty or its oldest record is still being written
+ */
+bool log_pop(uint8_t core, log_record_t *record) {
+    log_ring_t *ring = &log_rings[core];
+    uint32_t tail    = ring->tail;
+    uint32_t slot    = tail % LOG_RING_SIZE;
+    if (tail == ring->head || !ring->ready[slot]) return false;
+
+    __dmb();
+    *record           = ring->records[slot];
+    ring->ready[slot] = false;
+    __dmb(); // done with the slot before the producer can reuse it
+    ring->tail = tail + 1;
+    return true;
+}
+
+/**
+ * @brief Sends everything logged so far to Serial
+ * @note Call from core0's idle time, never from an IRQ
+ *
+ * @return uint16_t records sent
+ */
+uint16_t log_drain() {
+    uint16_t sent = 0;
+    log_record_t record;
+
+    for (uint8_t core = 0; core < LOG_CORES; core++) {
+        while (log_pop(core, &record)) {
+            __emit(&record);
+            sent++;
+        }
+
+        uint32_t dropped = log_dropped(core);
+        if (dropped == log_reported[core]) continue;
+        record.format      = LOG_DROPPED;
+        record.time_us     = micros();
+        record.level       = WARNING;
+        record.core        = core;
+        record.count       = 2;
+        record.args[0]     = dropped - log_reported[core];
+        record.args[1]     = core;
+        log_reported[core] = dropped;
+        __emit(&record);
+        sent++;
+    }
+    return sent;
+}
+
+/**
+ * @brief Expands a record into text, like snprintf() with its format and arguments
+ * @remarks Supports the d, i, u, x, X, o, c, f, e, g, s and p conversions with their
+ *          flags, width and precision. Length modifiers are dropped since every argument
+ *          is already 32 bits. tools/logdecode.py does the same on the host.
+ *
+ * @param output buffer for the text
+ * @param size length of output
+ * @param record record to expand
+ */
+void log_format(char *output, size_t size, const log_record_t *record) {
+    const char *f = record->format;
+    uint8_t arg   = 0;
+    size_t length = 0;
+    output[0]     = '\0';
+
+    while (*f != '\0' && length + 1 < size) {
+        if (*f != '%') {
+            output[length++] = *f++;
+            output[length]   = '\0';
+            continue;
+        }
+
+        // Flags, width and precision carry over, length modifiers don't
+        char spec[16] = "%";
+        uint8_t s     = 1;
+        for (f++; *f != '\0' && strchr("-+ #0123456789.", *f) != NULL; f++) {
+            if (s < sizeof(spec) - 2) spec[s++] = *f;
+        }
+        while (*f != '\0' && strchr("hlzjtL", *f) != NULL) f++;
+        if (*f == '\0') break;
+
+        char conversion = *f++;
+        uintptr_t value = (arg < record->count) ? record->args[arg] : 0;
+        if (conversion != '%') arg++;
+        __format_arg(output + length, size - length, spec, conversion, value);
+        length += strlen(output + length);
+    }
+}
+
+/**
+ * @brief Records a core has dropped since it started
+ *
+ * @param core ring to check
+ * @return uint32_t records lost to a full ring
+ */
+uint32_t log_dropped(uint8_t core) {
+    return log_rings[core].dropped;
+}
+
+/**
+ * @brief Writes one record out, as a binary record or as text with LOG_TEXT
+ */
+static void __emit(const log_record_t *record) {
+#ifdef LOG_TEXT
+    char line[128];
+    log_format(line, sizeof(line), record);
+    print_msg(line, (error_t)record->level);
+#else
+    uint8_t frame[LOG_HEADER_BYTES + 4 * LOG_MAX_ARGS];
+    uint32_t format = (uint32_t)(uintptr_t)record->format;
+    frame[0]        = LOG_SYNC_0;
+    frame[1]        = LOG_SYNC_1;
+    frame[2]        = record->level | (record->core << 4);
+    frame[3]        = record->count;
+    memcpy(&frame[4], &format, 4); // little endian on both ends
+    memcpy(&frame[8], &record->time_us, 4);
+    for (uint8_t i = 0; i < record->count; i++) {
+        uint32_t word = (uint32_t)record->args[i];
+        memcpy(&frame[LOG_HEADER_BYTES + 4 * i], &word, 4);
+    }
+    Serial.write(frame, LOG_HEADER_BYTES + 4 * record->count);
+#endif
+}
+
+/**
+ * @brief Formats one argument with snprintf(), cast back to the type its conversion wants
+ *
+ * @param output where the text goes
+ * @param size room left in output
+ * @param spec the conversion up to but not including its letter, e.g. "%-5.2"
+ * @param conversion conversion letter
+ * @param arg packed argument, a conversion log_format() doesn't know is copied as is
+ */
+static void __format_arg(char *output, size_t size, const char *spec, char conversion, uintptr_t arg) {
+    char full[20];
+    snprintf(full, sizeof(full), "%s%c", spec, conversion);
+
+    switch (conversion) {
+        case 'd':
+        case 'i':
+            snprintf(output, size, full, (int)(int32_t)arg);
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'c':
+            snprintf(output, size, full, (unsigned)(uint32_t)arg);
+            break;
+        case 'f':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G': {
+            uint32_t bits = (uint32_t)arg;
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            snprintf(output, size, full, (double)value);
+            break;
+        }
+        case 's':
+            snprintf(output, size, full, arg ? (const char *)arg : "(null)");
+            break;
+        case 'p':
+            snprintf(output, size, full, (void *)arg);
+            break;
+        case '%':
+            snprintf(output, size, "%%");
+            break;
+        default:
+            snprintf(output, size, "%s", full);
+            break;
+    }
+}
@@ -1,9 +1,9 @@
 #include "tuner.h"
 
+static_assert(CAPTURE_BITS <= FFT_MAX_BITS, "CAPTURE_BITS doesn't fit in the DSP arena");
+
 // Global variables
-uint16_t buffer1[CAPTURE_DEPTH];
-uint16_t buffer2[CAPTURE_DEPTH];
-fix15 fft_buffer[CAPTURE_DEPTH];
+volatile bool core0_ready = false;
 
 control_output_t control_output = {0};
 tuner_mode_t tuner_mode         = MODE_TUNER;
@@ -11,15 +11,56 @@ tuner_mode_t tuner_mode         = MODE_TUNER;
 void setup() {
     error_init();
     if (MSG_LEVEL == DEBUG) delay(4000); // Wait for serial monitor to start
-    print_msg("Beginning Setup", INFO);
+    LOG_INFO("Beginning Setup");
+    arena_report();
 
-    mic_init(buffer1, buffer2);
-    fft_init(fft_buffer, CAPTURE_BITS, MIC_SAMPLE_RATE);
     display_init();
     control_init(&control_output);
     tuner_init();
+#ifdef FFT_PARALLEL_STAGES
+    // Half of every radix-4 pass now runs in core0's SIO FIFO interrupt. It sits at the lowest
+    // priority so the USB, I2C and DMA interrupts still preempt it, but the display loop and
+    // anything else at that priority wait out up to half a pass each time, milliseconds at the
+    // default size, see the butterfly time in the profile dump
+    fft_parallel_helper_init();
+#endif
+
+    LOG_INFO("Setup complete!");
+    core0_ready = true;
+}
+
+/**
+ * @brief Core1 owns acquisition and pitch detection, core0 only renders and reads controls
+ * @note The mic DMA interrupt is claimed here so it fires on core1 too
+ *
+ */
+void setup1() {
+    // Serial and the tuner settings come up on core0 first
+    while (!core0_ready) tight_loop_contents();
 
-    print_msg("Setup complete!", INFO);
+    fft_init(CAPTURE_BITS, MIC_SAMPLE_RATE);
+#ifdef FFT_PARALLEL_STAGES
+    fft_set_parallel(true);
+#endif
+#ifdef GOERTZEL_REFINE
+    fft_set_refine(true);
+#endif
+#ifdef FFT_SLIDING_HOP
+    fft_set_hop(FFT_SLIDING_HOP);
+#endif
+    pipeline_init();
+    uint16_t *captures[CAPTURE_RING_DEPTH];
+    for (uint8_t i = 0; i < CAPTURE_RING_DEPTH; i++) captures[i] = dsp_arena.capture[i];
+    mic_init(captures, CAPTURE_RING_DEPTH);
+    fft_set_capture_ring(mic_capture_ring());
+#ifdef PROFILE
+    profile_watch_captures(mic_capture_ring());
+#endif
+    LOG_INFO("Core1 pipeline running");
+}
+
+void loop1() {
+    pipeline_step();
 }
 
 void loop() {
@@ -30,19 +71,19 @@ void loop() {
         switch (tuner_mode) {
             case MODE_TUNER:
                 tuner_mode = MODE_TUNER_MEME;
-                print_msg("mode switch: tuner meme", INFO);
+                LOG_INFO("mode switch: tuner meme");
                 break;
             case MODE_TUNER_MEME:
                 tuner_mode = MODE_SOUNDBACK;
-                print_msg("mode switch: soundback", INFO);
+                LOG_INFO("mode switch: soundback");
                 break;
             case MODE_SOUNDBACK:
                 tuner_mode = MODE_METRONOME;
-                print_msg("mode switch: metronome", INFO);
+                LOG_INFO("mode switch: metronome");
                 break;
             case MODE_METRONOME:
                 tuner_mode = MODE_TUNER;
-                print_msg("mode switch: tuner", INFO);
+                LOG_INFO("mode switch: tuner");
                 break;
             default:
                 tuner_mode = MODE_TUNER;
@@ -63,4 +104,8 @@ void loop() {
     } else {
         fatal_error("Invalid mode");
     }
+
+    /* SEND WHAT WAS LOGGED WHILE THE FRAME WAS BUSY, THEN TAKE COMMANDS */
+    log_drain();
+    profile_poll();
 }
\ No newline at end of file
@@ -2,21 +2,24 @@
 
 // Private functions
 void __dma_0_handler();
+static void __dma_channel_init(uint8_t index);
 
 // Globals
-uint16_t *dma_front_buf = NULL;
-uint16_t *dma_back_buf  = NULL;
-uint mic_dma_channel    = 0;
+capture_ring_t mic_ring;
+uint mic_dma_channel[2] = {0};                         // chained to each other, one always armed
+int8_t mic_dma_slot[2]  = {CAPTURE_NONE, CAPTURE_NONE}; // ring slot each channel writes to
 
 /**
  * @brief Inits the ADC and DMA for the microphone
+ * @remarks Two DMA channels take turns, each triggering the other when it finishes, so
+ *          the ADC FIFO is never left waiting on the IRQ to restart a transfer. Finished
+ *          buffers go to a capture_ring_t and only come back once the DSP releases them.
  *
- * @param front_buf front buffer for DMA transfer
- * @param back_buf back buffer for DMA transfer
+ * @param buffers capture buffers, each CAPTURE_DEPTH long
+ * @param count number of buffers, CAPTURE_RING_MIN or more
  */
-void mic_init(uint16_t *front_buf, uint16_t *back_buf) {
-    dma_front_buf = front_buf;
-    dma_back_buf  = back_buf;
+void mic_init(uint16_t *buffers[], uint8_t count) {
+    capture_ring_init(&mic_ring, buffers, count);
 
     /* ADC CONFIG */
     adc_init();
@@ -33,58 +36,71 @@ void mic_init(uint16_t *front_buf, uint16_t *back_buf) {
     adc_fifo_drain();
 
     /* DMA CONFIG*/
-    mic_dma_channel        = dma_claim_unused_channel(true);
-    dma_channel_config cfg = dma_channel_get_default_config(mic_dma_channel);
+    mic_dma_channel[0] = dma_claim_unused_channel(true);
+    mic_dma_channel[1] = dma_claim_unused_channel(true);
+    __dma_channel_init(0);
+    __dma_channel_init(1);
 
-    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16); // Use 16-bit transfers
-    channel_config_set_read_increment(&cfg, false);           // Read from same address
-    channel_config_set_write_increment(&cfg, true);           // Write to an incrementing address
-    channel_config_set_dreq(&cfg, DREQ_ADC);                  // Do a transfer when ADC FIFO sends DMA request
-
-    dma_channel_configure(mic_dma_channel,
-                          &cfg,
-                          dma_front_buf, // destination buffer
-                          &adc_hw->fifo, // source FIFO
-                          CAPTURE_DEPTH, // transfer count
-                          false          // don't start yet
-    );
-
-    // Set IRQ1 when transfer completed
-    dma_channel_set_irq0_enabled(mic_dma_channel, true);
+    // Set IRQ0 when either transfer completes
     irq_set_exclusive_handler(DMA_IRQ_0, __dma_0_handler);
     irq_set_enabled(DMA_IRQ_0, true);
 
     // start everything up now
     adc_run(true);
-    dma_channel_start(mic_dma_channel);
+    dma_channel_start(mic_dma_channel[0]);
+}
+
+/**
+ * @brief The ring the mic fills, for fft_set_capture_ring()
+ *
+ * @return capture_ring_t* mic capture ring
+ */
+capture_ring_t *mic_capture_ring() {
+    return &mic_ring;
 }
 
 /**
  * @brief Handler for IRQ0 DMA requests
+ * @remarks The other channel is already running by the time this fires, so all that's
+ *          left is to hand the finished buffer over and point its channel at a new one.
  */
 void __dma_0_handler() {
-    if (!dma_channel_get_irq0_status(mic_dma_channel)) { fatal_error("Unknown DMA channel interrupt"); }
-
-    dma_channel_acknowledge_irq0(mic_dma_channel);
-
-    // Swap front and back buffers
-    uint16_t *tmp = dma_front_buf;
-    dma_front_buf = dma_back_buf;
-    dma_back_buf  = tmp;
-
-    mic_dma_handler(dma_back_buf);
-
-    // Restart the dma
-    dma_channel_set_write_addr(mic_dma_channel, dma_front_buf, false);
-    dma_channel_start(mic_dma_channel);
+    bool handled = false;
+    for (uint8_t i = 0; i < 2; i++) {
+        uint channel = mic_dma_channel[i];
+        if (!dma_channel_get_irq0_status(channel)) continue;
+
+        dma_channel_acknowledge_irq0(channel);
+        capture_ring_filled(&mic_ring, mic_dma_slot[i], profile_now());
+
+        // Never CAPTURE_NONE: the DSP holds one buffer at most and the other channel one more
+        mic_dma_slot[i] = capture_ring_claim(&mic_ring);
+        dma_channel_set_write_addr(channel, mic_ring.buffers[mic_dma_slot[i]], false);
+        handled = true;
+    }
+    if (!handled) { fatal_error("Unknown DMA channel interrupt"); }
 }
 
 /**
- * @brief Weakly defined handler for the mic DMA
- * @note adds ability for other places to take action on DMA transfer complete
- *
+ * @brief Sets up one of the two mic DMA channels on its own ring slot, chained to the other
  */
-__attribute__((weak)) void mic_dma_handler(uint16_t *data) {
-    // noop if not defined
-    print_msg("Mic handler not implemented", INFO);
-}
\ No newline at end of file
+static void __dma_channel_init(uint8_t index) {
+    uint channel           = mic_dma_channel[index];
+    dma_channel_config cfg = dma_channel_get_default_config(channel);
+
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);         // Use 16-bit transfers
+    channel_config_set_read_increment(&cfg, false);                   // Read from same address
+    channel_config_set_write_increment(&cfg, true);                   // Write to an incrementing address
+    channel_config_set_dreq(&cfg, DREQ_ADC);                          // Do a transfer when ADC FIFO sends DMA request
+    channel_config_set_chain_to(&cfg, mic_dma_channel[index ^ 1]);    // Start the other channel when done
+
+    mic_dma_slot[index] = capture_ring_claim(&mic_ring);
+    dma_channel_configure(channel,
+                          &cfg,
+                          mic_ring.buffers[mic_dma_slot[index]], // destination buffer
+                          &adc_hw->fifo,                         // source FIFO
+                          CAPTURE_DEPTH,                         // transfer count
+                          false                                  // don't start yet
+    );
+    dma_channel_set_irq0_enabled(channel, true);
+}
@@ -0,0 +1,159 @@
+#include "pipeline.h"
+
+// Private functions
+static bool __queue_push(const pitch_result_t *result);
+
+// Global variables
+// Results travel core1 -> core0 through a single-producer/single-consumer ring.
+// Only core1 writes queue_head and only core0 writes queue_tail, so the acquire/release
+// pairs below are all the synchronization needed, no locks or FIFO spinning.
+pitch_result_t result_queue[PIPELINE_QUEUE_DEPTH];
+uint32_t queue_head     = 0;
+uint32_t queue_tail     = 0;
+uint32_t queue_dropped  = 0;
+uint32_t queue_sequence = 0;
+
+// Settings are requested by core0 and applied by core1 between frames
+pitch_engine_t requested_engine = ENGINE_FFT;
+uint16_t requested_center       = 440;
+uint8_t requested_bits          = 0; // 0 keeps the size fft_init() picked
+pitch_engine_t applied_engine   = ENGINE_FFT;
+uint16_t applied_center         = 0;
+uint8_t applied_bits            = 0;
+
+/**
+ * @brief Resets the result queue, call on core1 after fft_init()
+ *
+ */
+void pipeline_init() {
+    __atomic_store_n(&queue_head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&queue_tail, 0, __ATOMIC_RELAXED);
+    queue_dropped  = 0;
+    queue_sequence = 0;
+    applied_engine = __atomic_load_n(&requested_engine, __ATOMIC_ACQUIRE);
+    applied_center = 0; // forces the frequency table to be rebuilt on the first step
+    applied_bits   = fft_size();
+}
+
+/**
+ * @brief Runs one pass of the pitch pipeline and publishes any result
+ * @note Only call this from the producer core
+ *
+ * @return true if a result was queued
+ */
+bool pipeline_step() {
+    // Pick up settings changes before touching any DSP state
+    pitch_engine_t engine = __atomic_load_n(&requested_engine, __ATOMIC_ACQUIRE);
+    if (engine != applied_engine) {
+        // The old engine's history means nothing to the new one
+        applied_engine = engine;
+        fft_reset_smoothing();
+    }
+    uint16_t center = __atomic_load_n(&requested_center, __ATOMIC_ACQUIRE);
+    if (center != applied_center) {
+        applied_center = center;
+        change_fft_center(center);
+    }
+    uint8_t bits = __atomic_load_n(&requested_bits, __ATOMIC_ACQUIRE);
+    if (bits != 0 && bits != applied_bits) {
+        // Estimates are in Hz, so the smoothing history carries over to the new size
+        applied_bits = bits;
+        fft_set_size(bits);
+    }
+
+    fix15 frequency = (applied_engine == ENGINE_FFT) ? do_fft() : do_yin();
+    if (frequency == 0) return false;
+
+    pitch_result_t result = {0};
+    result.frequency      = frequency;
+    PROFILE_START(note_start);
+    freq2note(frequency, &result.note_index, &result.cents_deviation);
+    PROFILE_STOP(PROFILE_FREQ2NOTE, note_start);
+    result.sequence  = queue_sequence++;
+    result.timestamp = micros();
+    result.captured  = fft_frame_stamp();
+
+    return __queue_push(&result);
+}
+
+/**
+ * @brief Takes the oldest result off the queue
+ * @note Only call this from the consumer core
+ *
+ * @param result filled with the dequeued result
+ * @return true if a result was available
+ */
+bool pipeline_pop(pitch_result_t *result) {
+    uint32_t tail = __atomic_load_n(&queue_tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&queue_head, __ATOMIC_ACQUIRE);
+    if (head == tail) return false;
+
+    *result = result_queue[tail & (PIPELINE_QUEUE_DEPTH - 1)];
+    __atomic_store_n(&queue_tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Requests a pitch engine, applied by the producer before its next frame
+ *
+ * @param engine ENGINE_FFT or ENGINE_YIN
+ */
+void pipeline_set_engine(pitch_engine_t engine) {
+    __atomic_store_n(&requested_engine, engine, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Requests a new A4 reference, applied by the producer before its next frame
+ *
+ * @param center A4 frequency in Hz
+ */
+void pipeline_set_center(uint16_t center) {
+    __atomic_store_n(&requested_center, center, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Requests a new FFT frame size, applied by the producer before its next frame
+ * @note Only sizes between FFT_MIN_BITS and FFT_MAX_BITS are compiled in
+ *
+ * @param bits log2 of the frame length
+ */
+void pipeline_set_fft_size(uint8_t bits) {
+    __atomic_store_n(&requested_bits, bits, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Most recently requested pitch engine
+ *
+ * @return pitch_engine_t engine
+ */
+pitch_engine_t pipeline_engine() {
+    return __atomic_load_n(&requested_engine, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Number of results thrown away because the consumer fell behind
+ *
+ * @return uint32_t dropped results
+ */
+uint32_t pipeline_dropped() {
+    return __atomic_load_n(&queue_dropped, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Copies a result into the ring, dropping it if the consumer is a full queue behind
+ *
+ * @param result result to publish
+ * @return true if queued
+ */
+static bool __queue_push(const pitch_result_t *result) {
+    uint32_t head = __atomic_load_n(&queue_head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&queue_tail, __ATOMIC_ACQUIRE);
+    if (head - tail == PIPELINE_QUEUE_DEPTH) {
+        __atomic_store_n(&queue_dropped, queue_dropped + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    result_queue[head & (PIPELINE_QUEUE_DEPTH - 1)] = *result;
+    __atomic_store_n(&queue_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
@@ -0,0 +1,317 @@
+#include "profile.h"
+
+// Private defs
+static profile_stats_t *__current(profile_probe_t probe);
+static profile_frames_t *__current_frames();
+static uint8_t __bucket(uint32_t ticks);
+static uint32_t __bucket_floor(uint8_t bucket);
+
+// Global variables
+profile_stats_t profile_table[PROFILE_PROBES];
+const profile_stats_t profile_empty = {0};
+volatile uint32_t profile_epoch    = 1; // so a zeroed table starts out stale
+profile_frames_t profile_shown_frames;
+const profile_frames_t profile_no_frames = {0};
+const capture_ring_t *profile_captures   = NULL; // ring whose counters the dump ends with
+
+// FFT stage open on each core and when it started
+uint8_t stage_open[2]   = {PROFILE_PROBES, PROFILE_PROBES};
+uint32_t stage_start[2] = {0};
+
+char profile_command[PROFILE_COMMAND + 1];
+uint8_t profile_command_length = 0;
+
+const char *PROFILE_NAMES[PROFILE_PROBES] = {"decimate",
+                                             "ingest",
+                                             "bitreverse",
+                                             "butterfly",
+                                             "split",
+                                             "peak",
+                                             "interpolate",
+                                             "refine",
+                                             "average",
+                                             "freq2note",
+                                             "display tuner",
+                                             "display metronome",
+                                             "display soundback",
+                                             "flush",
+                                             "capture to panel"};
+
+/**
+ * @brief Adds one span to a probe
+ * @note Keep each probe to one core, the table has no lock
+ *
+ * @param probe where the time went
+ * @param ticks how long it took
+ */
+void profile_record(profile_probe_t probe, uint32_t ticks) {
+    if (probe >= PROFILE_PROBES) return;
+    profile_stats_t *stats = __current(probe);
+
+    stats->count++;
+    stats->sum += ticks;
+    if (ticks < stats->min) stats->min = ticks;
+    if (ticks > stats->max) stats->max = ticks;
+    stats->buckets[__bucket(ticks)]++;
+}
+
+/**
+ * @brief Ends the FFT stage running on this core, if any, and starts the next
+ * @remarks This is what FFT_STAGE_MARK() calls, so the stages need no probes of their own
+ *
+ * @param stage probe of the stage starting, PROFILE_FFT_STAGES or more to just end one
+ */
+void profile_stage(uint8_t stage) {
+    uint8_t core = get_core_num();
+    uint32_t now = profile_now(); // one read for both ends, the bookkeeping lands in the next stage
+    if (stage_open[core] < PROFILE_FFT_STAGES) {
+        profile_record((profile_probe_t)stage_open[core], now - stage_start[core]);
+    }
+    stage_open[core]  = stage < PROFILE_FFT_STAGES ? stage : PROFILE_PROBES;
+    stage_start[core] = now;
+}
+
+/**
+ * @brief Starts every probe over
+ * @remarks Safe from either core: each probe clears itself the next time its own core
+ *          records to it.
+ *
+ */
+void profile_reset() {
+    profile_epoch = profile_epoch + 1;
+}
+
+/**
+ * @brief Spans recorded to a probe since the last reset
+ *
+ * @param probe probe to look up
+ * @return const profile_stats_t* its table entry, all zeros if nothing since the reset
+ */
+const profile_stats_t *profile_get(profile_probe_t probe) {
+    const profile_stats_t *stats = &profile_table[probe];
+    return stats->epoch == profile_epoch ? stats : &profile_empty;
+}
+
+/**
+ * @brief Name a probe is listed under
+ *
+ * @param probe probe to look up
+ * @return const char* name, as in the serial dump
+ */
+const char *profile_name(profile_probe_t probe) {
+    return probe < PROFILE_PROBES ? PROFILE_NAMES[probe] : "";
+}
+
+/**
+ * @brief Closes the latency trace of a tuner frame now on the panel
+ * @remarks Called from the SSD1306 DMA IRQ as well as the display loop, so it runs with
+ *          interrupts off. A gap in the sequence numbers since the last frame shown is
+ *          results that were dropped or drawn over before they got there.
+ *
+ * @param sequence pitch_result_t sequence number the frame showed
+ * @param captured fft_frame_stamp() of its samples
+ */
+void profile_shown(uint32_t sequence, uint32_t captured) {
+    uint32_t status = save_and_disable_interrupts();
+    uint32_t now    = profile_now();
+
+    profile_frames_t *frames = __current_frames();
+    int32_t gap              = (int32_t)(sequence - frames->next_sequence);
+    if (!frames->resync && gap > 0) frames->dropped += gap;
+    frames->resync        = false;
+    frames->next_sequence = sequence + 1;
+    frames->shown++;
+    profile_record(PROFILE_LATENCY, now - captured);
+
+    restore_interrupts(status);
+}
+
+/**
+ * @brief Forgets where the sequence was, e.g. while another screen was up and nothing
+ *        was meant to be shown
+ *
+ */
+void profile_resync() {
+    uint32_t status = save_and_disable_interrupts();
+    __current_frames()->resync = true;
+    restore_interrupts(status);
+}
+
+/**
+ * @brief Tuner frames traced since the last reset
+ *
+ * @return const profile_frames_t* shown and dropped counts
+ */
+const profile_frames_t *profile_frames() {
+    return profile_shown_frames.epoch == profile_epoch ? &profile_shown_frames : &profile_no_frames;
+}
+
+/**
+ * @brief Has the dump list a capture ring's counters too
+ * @note They count from boot, a reset doesn't touch them
+ *
+ * @param ring ring to report on, NULL for none
+ */
+void profile_watch_captures(const capture_ring_t *ring) {
+    profile_captures = ring;
+}
+
+/**
+ * @brief Average span of a probe
+ *
+ * @param stats probe from profile_get()
+ * @return uint32_t ticks, 0 with no spans
+ */
+uint32_t profile_mean(const profile_stats_t *stats) {
+    return stats->count ? (uint32_t)(stats->sum / stats->count) : 0;
+}
+
+/**
+ * @brief Span that a given share of a probe's spans are at or under
+ * @remarks Comes from the histogram, so it's the top of the bucket the percentile falls
+ *          in, at most 1 / 2^PROFILE_SUB_BITS over, and never more than the max.
+ *
+ * @param stats probe from profile_get()
+ * @param percent e.g. 99
+ * @return uint32_t ticks, 0 with no spans
+ */
+uint32_t profile_percentile(const profile_stats_t *stats, uint8_t percent) {
+    if (stats->count == 0) return 0;
+    uint64_t wanted = ((uint64_t)stats->count * percent + 99) / 100;
+    uint64_t seen   = 0;
+    for (uint8_t b = 0; b < PROFILE_BUCKETS - 1; b++) {
+        seen += stats->buckets[b];
+        if (seen < wanted) continue;
+        uint32_t top = __bucket_floor(b + 1) - 1;
+        return top < stats->max ? top : stats->max;
+    }
+    return stats->max;
+}
+
+/**
+ * @brief Prints the table to Serial
+ *
+ */
+void profile_dump() {
+    char line[96];
+    snprintf(line,
+             sizeof(line),
+             "profile: %-18s %8s %9s %9s %9s %9s (us)",
+             "probe",
+             "count",
+             "min",
+             "mean",
+             "p99",
+             "max");
+    Serial.println(line);
+
+    float scale = 1.0f / PROFILE_TICKS_PER_US;
+    for (uint8_t p = 0; p < PROFILE_PROBES; p++) {
+        const profile_stats_t *stats = profile_get((profile_probe_t)p);
+        if (stats->count == 0) continue;
+        snprintf(line,
+                 sizeof(line),
+                 "profile: %-18s %8u %9.1f %9.1f %9.1f %9.1f",
+                 PROFILE_NAMES[p],
+                 (unsigned)stats->count,
+                 stats->min * scale,
+                 profile_mean(stats) * scale,
+                 profile_percentile(stats, 99) * scale,
+                 stats->max * scale);
+        Serial.println(line);
+    }
+
+    const profile_frames_t *frames = profile_frames();
+    snprintf(line,
+             sizeof(line),
+             "profile: %u tuner frames shown, %u results dropped",
+             (unsigned)frames->shown,
+             (unsigned)frames->dropped);
+    Serial.println(line);
+
+    if (profile_captures == NULL) return;
+    snprintf(line,
+             sizeof(line),
+             "profile: %u captures, %u processed, %u dropped, %u waiting",
+             (unsigned)profile_captures->produced,
+             (unsigned)profile_captures->consumed,
+             (unsigned)profile_captures->dropped,
+             (unsigned)capture_ring_pending(profile_captures));
+    Serial.println(line);
+}
+
+/**
+ * @brief Reads serial commands, call from core0's idle time
+ * @remarks "profile" prints the table, "profile reset" starts it over. Lines end with
+ *          either CR or LF.
+ *
+ */
+void profile_poll() {
+    while (Serial.available() > 0) {
+        char c = Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (profile_command_length < PROFILE_COMMAND) profile_command[profile_command_length++] = c;
+            continue;
+        }
+
+        profile_command[profile_command_length] = '\0';
+        profile_command_length                  = 0;
+        if (strcmp(profile_command, "profile") == 0) {
+            profile_dump();
+        } else if (strcmp(profile_command, "profile reset") == 0) {
+            profile_reset();
+            Serial.println("profile: reset");
+        } else if (profile_command[0] != '\0') {
+            Serial.println("unknown command, try \"profile\" or \"profile reset\"");
+        }
+    }
+}
+
+/**
+ * @brief A probe's table entry, cleared first if there's been a reset since it was last used
+ */
+static profile_stats_t *__current(profile_probe_t probe) {
+    profile_stats_t *stats = &profile_table[probe];
+    uint32_t epoch         = profile_epoch;
+    if (stats->epoch != epoch) {
+        memset(stats, 0, sizeof(*stats));
+        stats->min   = UINT32_MAX;
+        stats->epoch = epoch;
+    }
+    return stats;
+}
+
+/**
+ * @brief The frame counts, cleared first if there's been a reset since they were last used
+ */
+static profile_frames_t *__current_frames() {
+    uint32_t epoch = profile_epoch;
+    if (profile_shown_frames.epoch != epoch) {
+        memset(&profile_shown_frames, 0, sizeof(profile_shown_frames));
+        profile_shown_frames.resync = true;
+        profile_shown_frames.epoch  = epoch;
+    }
+    return &profile_shown_frames;
+}
+
+/**
+ * @brief Histogram bucket for a span: exact below 2^PROFILE_SUB_BITS, then
+ *        2^PROFILE_SUB_BITS buckets per power of 2
+ */
+static uint8_t __bucket(uint32_t ticks) {
+    if (ticks < (1u << PROFILE_SUB_BITS)) return ticks;
+    uint8_t top    = 31 - __builtin_clz(ticks);
+    uint32_t index = ((top - PROFILE_SUB_BITS + 1) << PROFILE_SUB_BITS) +
+                     ((ticks >> (top - PROFILE_SUB_BITS)) & ((1u << PROFILE_SUB_BITS) - 1));
+    return index < PROFILE_BUCKETS ? index : PROFILE_BUCKETS - 1;
+}
+
+/**
+ * @brief Smallest span that lands in a bucket
+ */
+static uint32_t __bucket_floor(uint8_t bucket) {
+    if (bucket < (1u << PROFILE_SUB_BITS)) return bucket;
+    uint8_t top  = (bucket >> PROFILE_SUB_BITS) + PROFILE_SUB_BITS - 1;
+    uint32_t sub = bucket & ((1u << PROFILE_SUB_BITS) - 1);
+    return ((1u << PROFILE_SUB_BITS) + sub) << (top - PROFILE_SUB_BITS);
+}
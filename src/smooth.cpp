@@ -0,0 +1,191 @@
+#include "smooth.h"
+
+// Private defs
+#define SMOOTH_CUTOFF_LIMIT (1LL << 30) // Q16 Hz, past this a One-Euro alpha is 1 at any frame rate
+#define SMOOTH_SPEED_LIMIT  (1LL << 40) // Q16 cents/s, 16 million is no longer a pitch
+#define TWO_PI_Q16          411775LL
+
+static inline int64_t __freq2cents(fix15 freq);
+static inline fix15 __cents2freq(int64_t cents);
+static int64_t __one_euro_alpha(int64_t cutoff, uint32_t rate);
+static inline bool __outside_gate(int64_t delta, int64_t var);
+
+/**
+ * @brief Forgets the filter's state, the next frame is passed straight through
+ *
+ * @param filter filter to clear
+ */
+void one_euro_reset(one_euro_t *filter) {
+    filter->cents   = 0;
+    filter->speed   = 0;
+    filter->pending = 0;
+    filter->held    = 0;
+    filter->primed  = false;
+}
+
+/**
+ * @brief Feeds one frame's estimate through the One-Euro filter
+ * @remarks A first order low-pass whose cutoff is ONE_EURO_MIN_CUTOFF plus ONE_EURO_BETA
+ *          times how fast the pitch is moving, so a held note is smoothed hard and a note
+ *          change opens the filter right up. The speed comes from its own low-pass. A frame
+ *          more than ONE_EURO_SNAP_CENTS away is held back, and once ONE_EURO_CONFIRM of them
+ *          in a row agree the filter restarts from their mean. A shorter run is dropped, so a
+ *          harmonic picked for one frame neither shows nor drags the next few off.
+ *
+ * @param filter filter state
+ * @param freq newest raw frequency estimate
+ * @param rate frames per second in Q16, sets the filter time step
+ * @return fix15 smoothed frequency
+ */
+fix15 one_euro_update(one_euro_t *filter, fix15 freq, uint32_t rate) {
+    const int64_t min_cutoff = (int64_t)(ONE_EURO_MIN_CUTOFF * (1 << 16));
+    const int64_t beta       = (int64_t)(ONE_EURO_BETA * (1 << 16));
+    const int64_t d_cutoff   = (int64_t)(ONE_EURO_D_CUTOFF * (1 << 16));
+    const int64_t snap       = (int64_t)(ONE_EURO_SNAP_CENTS * (1 << 16));
+    if (freq <= 0) return freq;
+
+    int64_t cents = __freq2cents(freq);
+    if (!filter->primed) {
+        filter->cents  = cents;
+        filter->speed  = 0;
+        filter->held   = 0;
+        filter->primed = true;
+        return freq;
+    }
+
+    if (llabs(cents - filter->cents) > snap) {
+        if (filter->held && llabs(cents - filter->pending / filter->held) <= snap) {
+            filter->pending += cents;
+            filter->held++;
+        } else {
+            filter->pending = cents;
+            filter->held    = 1;
+        }
+
+        if (filter->held >= ONE_EURO_CONFIRM) {
+            // Enough frames agree on somewhere new, so start over from there
+            filter->cents = filter->pending / filter->held;
+            filter->speed = 0;
+            filter->held  = 0;
+        }
+        return __cents2freq(filter->cents);
+    }
+    filter->held = 0;
+
+    // Clamped so the products stay in range, by then the filter is wide open anyway
+    int64_t speed = constrain(((cents - filter->cents) * rate) >> 16, -SMOOTH_SPEED_LIMIT, SMOOTH_SPEED_LIMIT);
+    filter->speed += ((__one_euro_alpha(d_cutoff, rate) >> 14) * (speed - filter->speed)) >> 16;
+
+    int64_t cutoff = min_cutoff + ((llabs(filter->speed) * beta) >> 16);
+    filter->cents += (__one_euro_alpha(cutoff, rate) * (cents - filter->cents)) >> 30;
+
+    return __cents2freq(filter->cents);
+}
+
+/**
+ * @brief Forgets the filter's state, the next frame is passed straight through
+ *
+ * @param filter filter to clear
+ */
+void kalman_reset(kalman_t *filter) {
+    filter->cents   = 0;
+    filter->var     = 0;
+    filter->pending = 0;
+    filter->held    = 0;
+    filter->primed  = false;
+}
+
+/**
+ * @brief Feeds one frame's estimate through the Kalman filter
+ * @remarks The pitch is a random walk of KALMAN_DRIFT_CENTS per frame seen through
+ *          KALMAN_NOISE_CENTS of noise, so a held note settles to a small gain. A frame
+ *          more than KALMAN_GATE sigmas away is held back. Once KALMAN_CONFIRM of them in a
+ *          row agree the note has changed and the filter restarts from their mean, a shorter
+ *          run was outliers and is dropped. Jumps of an octave need KALMAN_OCTAVE_CONFIRM.
+ *
+ * @param filter filter state
+ * @param freq newest raw frequency estimate
+ * @return fix15 smoothed frequency
+ */
+fix15 kalman_update(kalman_t *filter, fix15 freq) {
+    const int64_t drift = (int64_t)(KALMAN_DRIFT_CENTS * KALMAN_DRIFT_CENTS * (1 << 16));
+    const int64_t noise = (int64_t)(KALMAN_NOISE_CENTS * KALMAN_NOISE_CENTS * (1 << 16));
+    if (freq <= 0) return freq;
+
+    int64_t cents = __freq2cents(freq);
+    if (!filter->primed) {
+        filter->cents  = cents;
+        filter->var    = noise;
+        filter->held   = 0;
+        filter->primed = true;
+        return freq;
+    }
+
+    filter->var += drift;
+    int64_t innovation = cents - filter->cents;
+    if (__outside_gate(innovation, filter->var + noise)) {
+        if (filter->held && !__outside_gate(cents - filter->pending / filter->held, 2 * noise)) {
+            filter->pending += cents;
+            filter->held++;
+        } else {
+            filter->pending = cents;
+            filter->held    = 1;
+        }
+
+        // Exactly an octave out is far more often a harmonic than the player, so wants more proof
+        int64_t octave = llabs(innovation) - (1200LL << 16);
+        uint8_t needed = __outside_gate(octave, filter->var + noise) ? KALMAN_CONFIRM : KALMAN_OCTAVE_CONFIRM;
+        if (filter->held >= needed) {
+            // Enough frames agree on somewhere new, so start over from there
+            filter->cents = filter->pending / filter->held;
+            filter->var   = noise / filter->held;
+            filter->held  = 0;
+        }
+        return __cents2freq(filter->cents);
+    }
+
+    int64_t gain = (filter->var << 30) / (filter->var + noise);
+    filter->cents += (gain * innovation) >> 30;
+    filter->var -= (gain * filter->var) >> 30;
+    filter->held = 0;
+    return __cents2freq(filter->cents);
+}
+
+/**
+ * @brief log2 of a fix15 frequency in cents, Q16
+ * @note Offset by 15 octaves since the fix15 is taken as an integer, which cancels out
+ */
+static inline int64_t __freq2cents(fix15 freq) {
+    return (table_log2(freq) * 1200) >> 14;
+}
+
+/**
+ * @brief Inverse of __freq2cents()
+ */
+static inline fix15 __cents2freq(int64_t cents) {
+    return (fix15)table_exp2((cents << 14) / 1200);
+}
+
+/**
+ * @brief Smoothing factor of a one pole low-pass, 2 pi fc Te / (1 + 2 pi fc Te)
+ *
+ * @param cutoff corner frequency in Hz, Q16
+ * @param rate frames per second in Q16
+ * @return int64_t alpha in Q30
+ */
+static int64_t __one_euro_alpha(int64_t cutoff, uint32_t rate) {
+    if (cutoff > SMOOTH_CUTOFF_LIMIT) cutoff = SMOOTH_CUTOFF_LIMIT;
+    int64_t step = cutoff * TWO_PI_Q16 / rate;
+    return (step << 30) / (step + (1 << 16));
+}
+
+/**
+ * @brief Whether a difference is more than KALMAN_GATE standard deviations
+ *
+ * @param delta difference in cents, Q16
+ * @param var variance it's judged against in cents^2, Q16
+ */
+static inline bool __outside_gate(int64_t delta, int64_t var) {
+    if (llabs(delta) >= (1LL << 30)) return true;
+    return ((delta * delta) >> 16) > KALMAN_GATE * KALMAN_GATE * var;
+}
@@ -0,0 +1,301 @@
+#include "ssd1306.h"
+
+// Private defs
+#define SSD1306_NONE    -1
+#define SSD1306_COMMAND 0x00 // control byte, the rest of the transfer is commands
+#define SSD1306_DATA    0x40 // control byte, the rest of the transfer is GDDRAM data
+
+static int8_t __free_stream();
+static void __start(int8_t index);
+static void __push(uint16_t byte);
+static bool __stuck(uint32_t since);
+void __ssd1306_dma_handler();
+
+// Global variables
+ssd1306_stream_t ssd1306_streams[SSD1306_STREAMS];
+i2c_inst_t *ssd1306_i2c         = NULL;
+uint ssd1306_dma_channel        = 0;
+volatile int8_t stream_building = SSD1306_NONE;
+volatile int8_t stream_sending  = SSD1306_NONE; // only the DMA IRQ clears this, only __start() sets it
+volatile int8_t stream_queued   = SSD1306_NONE;
+volatile uint32_t stream_start  = 0;
+bool stream_lost                = false;
+ssd1306_stats_t ssd1306_counters = {0};
+
+/**
+ * @brief Takes over an I2C peripheral for the display
+ * @note The panel has to be initialised already, e.g. by U8g2's begin(). Only page
+ *       addressing is set here, since that's what the streams use.
+ *
+ * @param i2c peripheral the display is on
+ * @param address 7-bit display address
+ */
+void ssd1306_init(i2c_inst_t *i2c, uint8_t address) {
+    ssd1306_i2c = i2c;
+
+    // The target is fixed from here on, so every transfer in a stream goes to the display
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+    hw->enable   = 0;
+    hw->tar      = address;
+    hw->enable   = I2C_IC_ENABLE_ENABLE_BITS;
+
+    ssd1306_dma_channel    = dma_claim_unused_channel(true);
+    dma_channel_config cfg = dma_channel_get_default_config(ssd1306_dma_channel);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16); // IC_DATA_CMD takes the byte and its flags
+    channel_config_set_read_increment(&cfg, true);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_dreq(&cfg, i2c_get_dreq(i2c, true)); // paced by room in the TX FIFO
+    dma_channel_configure(ssd1306_dma_channel, &cfg, &hw->data_cmd, NULL, 0, false);
+
+    // IRQ0 belongs to the mic
+    dma_channel_set_irq1_enabled(ssd1306_dma_channel, true);
+    irq_set_exclusive_handler(DMA_IRQ_1, __ssd1306_dma_handler);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    ssd1306_begin();
+    __push(SSD1306_COMMAND);
+    __push(0x20);
+    __push(0x02 | I2C_IC_DATA_CMD_STOP_BITS);
+    ssd1306_commit();
+    ssd1306_wait();
+}
+
+/**
+ * @brief Starts a new stream, taking back the queued one if it hasn't gone out yet
+ * @remarks A newer frame replaces a queued one rather than waiting behind it, so at most
+ *          one stream is ever ahead of the frame being built. The replaced stream's tiles
+ *          never reach the panel, so the caller has to send them again with this one, see
+ *          framediff_retract().
+ *
+ * @return true if a queued stream was taken back
+ */
+bool ssd1306_begin() {
+    uint32_t status = save_and_disable_interrupts();
+    int8_t index    = stream_queued;
+    stream_queued   = SSD1306_NONE;
+    restore_interrupts(status);
+
+    bool replaced = index != SSD1306_NONE;
+    if (replaced) {
+        ssd1306_counters.replaced++;
+    } else {
+        index = __free_stream();
+    }
+
+    if (index == SSD1306_NONE) {
+        uint32_t start = micros();
+        while ((index = __free_stream()) == SSD1306_NONE) {
+            if (__stuck(start)) break;
+            tight_loop_contents();
+        }
+        ssd1306_counters.waits++;
+        ssd1306_counters.wait_us += micros() - start;
+        if (index == SSD1306_NONE) index = __free_stream();
+    }
+
+    ssd1306_streams[index].length = 0;
+    ssd1306_streams[index].traced = false;
+    stream_building               = index;
+    return replaced;
+}
+
+/**
+ * @brief Adds a run of tiles on one tile row to the stream being built
+ * @remarks Each run is two transfers: the page and start column as commands, then the
+ *          tile bytes as data. Page addressing wraps at the end of the row, so no end
+ *          column is needed.
+ *
+ * @param frame framebuffer in the U8g2 SSD1306 layout
+ * @param tx first tile column
+ * @param ty tile row, which is also the GDDRAM page
+ * @param tw number of tiles
+ */
+void ssd1306_tiles(const uint8_t *frame, uint8_t tx, uint8_t ty, uint8_t tw) {
+    uint8_t column = tx * 8;
+    __push(SSD1306_COMMAND);
+    __push(0xB0 | ty);
+    __push(0x00 | (column & 0x0F));
+    __push((0x10 | (column >> 4)) | I2C_IC_DATA_CMD_STOP_BITS);
+
+    const uint8_t *data = frame + ty * DISPLAY_WIDTH + column;
+    uint16_t count      = tw * 8;
+    __push(SSD1306_DATA);
+    for (uint16_t i = 0; i < count - 1; i++) __push(data[i]);
+    __push(data[count - 1] | I2C_IC_DATA_CMD_STOP_BITS);
+}
+
+/**
+ * @brief Tags the stream being built with the pitch result it shows, for the latency trace
+ *
+ * @param sequence pitch_result_t sequence number
+ * @param captured fft_frame_stamp() of its samples
+ */
+void ssd1306_trace(uint32_t sequence, uint32_t captured) {
+    if (stream_building == SSD1306_NONE) return;
+    ssd1306_stream_t *stream = &ssd1306_streams[stream_building];
+    stream->traced           = true;
+    stream->sequence         = sequence;
+    stream->captured         = captured;
+}
+
+/**
+ * @brief Hands the stream that was built to the DMA and returns straight away
+ * @remarks Starts it now if the bus is idle, otherwise it goes out when the DMA IRQ
+ *          retires the one in flight.
+ *
+ */
+void ssd1306_commit() {
+    int8_t index    = stream_building;
+    stream_building = SSD1306_NONE;
+    if (index == SSD1306_NONE) return;
+    if (ssd1306_streams[index].length == 0) {
+#ifdef PROFILE
+        // Nothing changed, so the panel already shows it
+        ssd1306_stream_t *stream = &ssd1306_streams[index];
+        if (stream->traced) profile_shown(stream->sequence, stream->captured);
+#endif
+        return;
+    }
+
+    ssd1306_counters.streams++;
+    ssd1306_counters.words += ssd1306_streams[index].length;
+
+    // The IRQ mustn't retire the stream in flight between the check and the queueing
+    uint32_t status = save_and_disable_interrupts();
+    if (stream_sending == SSD1306_NONE) {
+        __start(index);
+    } else {
+        stream_queued = index;
+    }
+    restore_interrupts(status);
+}
+
+/**
+ * @brief Whether a stream is still on the bus or waiting for it
+ *
+ * @return true if the display hasn't caught up with the last commit
+ */
+bool ssd1306_busy() {
+    return stream_sending != SSD1306_NONE || stream_queued != SSD1306_NONE;
+}
+
+/**
+ * @brief Blocks until everything committed is on the bus
+ * @note Gives up after SSD1306_TIMEOUT_US, see ssd1306_lost()
+ *
+ */
+void ssd1306_wait() {
+    while (ssd1306_busy()) {
+        if (__stuck(stream_start)) break;
+        tight_loop_contents();
+    }
+}
+
+/**
+ * @brief Whether a stream has been dropped since the last call
+ * @note The panel may be missing tiles after that, so the caller should resend everything
+ *
+ * @return true once after a timeout
+ */
+bool ssd1306_lost() {
+    bool lost   = stream_lost;
+    stream_lost = false;
+    return lost;
+}
+
+/**
+ * @brief Transfer counters since ssd1306_init()
+ *
+ * @return const ssd1306_stats_t* counters
+ */
+const ssd1306_stats_t *ssd1306_stats() {
+    return &ssd1306_counters;
+}
+
+/**
+ * @brief Retires the stream that just finished and starts the queued one
+ *
+ */
+void __ssd1306_dma_handler() {
+    if (!dma_channel_get_irq1_status(ssd1306_dma_channel)) return;
+    dma_channel_acknowledge_irq1(ssd1306_dma_channel);
+
+#ifdef PROFILE
+    int8_t sent = stream_sending;
+    if (sent != SSD1306_NONE && ssd1306_streams[sent].traced) {
+        profile_shown(ssd1306_streams[sent].sequence, ssd1306_streams[sent].captured);
+    }
+#endif
+
+    // A stream is always either sending or queued, so ssd1306_begin() can't take it in between
+    int8_t next = stream_queued;
+    if (next != SSD1306_NONE) {
+        __start(next);
+        stream_queued = SSD1306_NONE;
+    } else {
+        stream_sending = SSD1306_NONE;
+    }
+}
+
+/**
+ * @brief A stream that isn't being built, sent or waiting to be sent
+ *
+ * @return int8_t stream index, SSD1306_NONE if all are taken
+ */
+static int8_t __free_stream() {
+    // The IRQ moves a stream from queued to sending by setting sending first, so reading
+    // queued first can't miss it in between
+    int8_t queued  = stream_queued;
+    int8_t sending = stream_sending;
+    for (int8_t i = 0; i < SSD1306_STREAMS; i++) {
+        if (i != sending && i != queued && i != stream_building) return i;
+    }
+    return SSD1306_NONE;
+}
+
+/**
+ * @brief Points the DMA at a stream and sets it going
+ * @note Call with the DMA IRQ unable to run, i.e. from it or with interrupts disabled
+ */
+static void __start(int8_t index) {
+    stream_sending = index;
+    stream_start   = micros();
+    dma_channel_transfer_from_buffer_now(ssd1306_dma_channel,
+                                         ssd1306_streams[index].words,
+                                         ssd1306_streams[index].length);
+}
+
+/**
+ * @brief Appends one IC_DATA_CMD word to the stream being built
+ */
+static void __push(uint16_t byte) {
+    ssd1306_stream_t *stream = &ssd1306_streams[stream_building];
+    if (stream->length >= SSD1306_STREAM_WORDS) { fatal_error("SSD1306 stream overflow"); }
+    stream->words[stream->length++] = byte;
+}
+
+/**
+ * @brief Checks the stream in flight against SSD1306_TIMEOUT_US and drops everything if it's stuck
+ * @remarks A NACK or a held SCL leaves the DMA waiting on a TX FIFO that never drains.
+ *          The channel is aborted, the abort cleared, and both streams are dropped.
+ *
+ * @param since micros() the wait started
+ * @return true if the streams were dropped
+ */
+static bool __stuck(uint32_t since) {
+    if ((uint32_t)(micros() - since) < SSD1306_TIMEOUT_US) return false;
+
+    uint32_t status = save_and_disable_interrupts();
+    dma_channel_abort(ssd1306_dma_channel);
+    dma_channel_acknowledge_irq1(ssd1306_dma_channel);
+    i2c_hw_t *hw = i2c_get_hw(ssd1306_i2c);
+    if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) (void)hw->clr_tx_abrt;
+    stream_sending = SSD1306_NONE;
+    stream_queued  = SSD1306_NONE;
+    restore_interrupts(status);
+
+    stream_lost = true;
+    ssd1306_counters.timeouts++;
+    LOG_WARNING("SSD1306 transfer timed out");
+    return true;
+}
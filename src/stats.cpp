@@ -0,0 +1,222 @@
+#include "stats.h"
+
+// Private defs
+#define STATS_LOW  0 // max-heap, everything at or below the median
+#define STATS_HIGH 1 // min-heap, everything above it
+
+static inline bool __heap_above(const stats_t *stats, uint8_t h, uint8_t a, uint8_t b);
+static inline void __heap_swap(stats_t *stats, uint8_t h, uint8_t i, uint8_t j);
+static void __heap_sift(stats_t *stats, uint8_t h, uint8_t pos);
+static void __heap_insert(stats_t *stats, uint8_t h, uint8_t slot);
+static uint8_t __heap_remove(stats_t *stats, uint8_t h, uint8_t pos);
+static void __median_insert(stats_t *stats, uint8_t slot);
+static void __median_rebalance(stats_t *stats);
+
+/**
+ * @brief Sets up an empty window
+ *
+ * @param stats window to set up
+ * @param window number of samples kept, at most STATS_MAX_WINDOW
+ */
+void stats_init(stats_t *stats, uint8_t window) {
+    if (window == 0 || window > STATS_MAX_WINDOW) { fatal_error("Invalid stats window"); }
+    stats->window = window;
+    stats_reset(stats);
+}
+
+/**
+ * @brief Forgets every sample, keeping the window length
+ *
+ * @param stats window to clear
+ */
+void stats_reset(stats_t *stats) {
+    stats->count                 = 0;
+    stats->next                  = 0;
+    stats->sum                   = 0;
+    stats->mean_q                = 0;
+    stats->m2                    = 0;
+    stats->heap_size[STATS_LOW]  = 0;
+    stats->heap_size[STATS_HIGH] = 0;
+}
+
+/**
+ * @brief Adds a sample, pushing out the oldest once the window is full
+ * @remarks Sum, mean and variance update in constant time. Welford's update is run
+ *          forwards for a new sample and backwards for the one leaving, on a mean with
+ *          STATS_MEAN_BITS of headroom so rounding doesn't build up in m2. The median
+ *          heaps know where every ring slot sits, so the leaving sample comes out in
+ *          O(log n) without a search.
+ * @note Products of differences have to fit an int64, so keep samples within ±2^28 (8kHz)
+ *
+ * @param stats window to update
+ * @param x new sample
+ */
+void stats_push(stats_t *stats, fix15 x) {
+    uint8_t slot   = stats->next;
+    int64_t x_q    = (int64_t)x << STATS_MEAN_BITS;
+    int64_t mean_q = stats->mean_q;
+
+    if (stats->count == stats->window) {
+        // Swap the oldest sample for the new one, the count stays put
+        fix15 old = stats->values[slot];
+        __heap_remove(stats, stats->slot_heap[slot], stats->slot_pos[slot]);
+
+        stats->sum += (int64_t)x - old;
+        stats->mean_q  = (stats->sum << STATS_MEAN_BITS) / stats->count;
+        int64_t spread = (x_q - stats->mean_q) + (((int64_t)old << STATS_MEAN_BITS) - mean_q);
+        stats->m2 += ((int64_t)(x - old) * spread) >> (15 + STATS_MEAN_BITS);
+    } else {
+        stats->count++;
+        stats->sum += x;
+        stats->mean_q = (stats->sum << STATS_MEAN_BITS) / stats->count;
+        stats->m2 += (((x_q - mean_q) >> STATS_MEAN_BITS) * (x_q - stats->mean_q)) >> (15 + STATS_MEAN_BITS);
+    }
+
+    stats->values[slot] = x;
+    stats->next         = (slot + 1 == stats->window) ? 0 : slot + 1;
+    __median_insert(stats, slot);
+}
+
+/**
+ * @brief Number of samples in the window
+ *
+ * @param stats window to read
+ * @return uint8_t samples held, at most the window length
+ */
+uint8_t stats_count(const stats_t *stats) {
+    return stats->count;
+}
+
+/**
+ * @brief Mean of the window
+ *
+ * @param stats window to read
+ * @return fix15 mean, 0 if empty
+ */
+fix15 stats_mean(const stats_t *stats) {
+    return (fix15)(stats->mean_q >> STATS_MEAN_BITS);
+}
+
+/**
+ * @brief Population variance of the window
+ *
+ * @param stats window to read
+ * @return fix15 variance, 0 if empty
+ */
+fix15 stats_variance(const stats_t *stats) {
+    if (stats->count == 0 || stats->m2 <= 0) return 0;
+    return (fix15)(stats->m2 / stats->count);
+}
+
+/**
+ * @brief Median of the window, the mean of the middle two for an even count
+ *
+ * @param stats window to read
+ * @return fix15 median, 0 if empty
+ */
+fix15 stats_median(const stats_t *stats) {
+    if (stats->count == 0) return 0;
+
+    fix15 low = stats->values[stats->heap[STATS_LOW][0]];
+    if (stats->heap_size[STATS_LOW] > stats->heap_size[STATS_HIGH]) return low;
+
+    fix15 high = stats->values[stats->heap[STATS_HIGH][0]];
+    return low + ((high - low) >> 1);
+}
+
+/**
+ * @brief Whether slot a belongs nearer the top of heap h than slot b
+ */
+static inline bool __heap_above(const stats_t *stats, uint8_t h, uint8_t a, uint8_t b) {
+    return (h == STATS_LOW) ? stats->values[a] > stats->values[b] : stats->values[a] < stats->values[b];
+}
+
+/**
+ * @brief Swaps two heap entries and keeps the slot positions in step
+ */
+static inline void __heap_swap(stats_t *stats, uint8_t h, uint8_t i, uint8_t j) {
+    uint8_t *heap            = stats->heap[h];
+    uint8_t tmp              = heap[i];
+    heap[i]                  = heap[j];
+    heap[j]                  = tmp;
+    stats->slot_pos[heap[i]] = i;
+    stats->slot_pos[heap[j]] = j;
+}
+
+/**
+ * @brief Moves an entry up or down heap h until the heap order holds again
+ *
+ * @param stats window
+ * @param h STATS_LOW or STATS_HIGH
+ * @param pos position of the entry that may be out of place
+ */
+static void __heap_sift(stats_t *stats, uint8_t h, uint8_t pos) {
+    uint8_t *heap = stats->heap[h];
+    uint8_t size  = stats->heap_size[h];
+
+    while (pos > 0 && __heap_above(stats, h, heap[pos], heap[(pos - 1) / 2])) {
+        __heap_swap(stats, h, pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+    while (true) {
+        uint8_t top   = pos;
+        uint8_t left  = 2 * pos + 1;
+        uint8_t right = left + 1;
+        if (left < size && __heap_above(stats, h, heap[left], heap[top])) top = left;
+        if (right < size && __heap_above(stats, h, heap[right], heap[top])) top = right;
+        if (top == pos) break;
+        __heap_swap(stats, h, pos, top);
+        pos = top;
+    }
+}
+
+/**
+ * @brief Adds a ring slot to heap h
+ */
+static void __heap_insert(stats_t *stats, uint8_t h, uint8_t slot) {
+    uint8_t pos            = stats->heap_size[h]++;
+    stats->heap[h][pos]    = slot;
+    stats->slot_heap[slot] = h;
+    stats->slot_pos[slot]  = pos;
+    __heap_sift(stats, h, pos);
+}
+
+/**
+ * @brief Takes the entry at pos out of heap h
+ *
+ * @return uint8_t ring slot that was removed
+ */
+static uint8_t __heap_remove(stats_t *stats, uint8_t h, uint8_t pos) {
+    uint8_t slot = stats->heap[h][pos];
+    uint8_t last = --stats->heap_size[h];
+    if (pos != last) {
+        __heap_swap(stats, h, pos, last);
+        __heap_sift(stats, h, pos);
+    }
+    return slot;
+}
+
+/**
+ * @brief Files a ring slot on the correct side of the median, then evens up the halves
+ */
+static void __median_insert(stats_t *stats, uint8_t slot) {
+    // With the lower half empty, anything below the upper half's minimum still belongs low
+    fix15 x  = stats->values[slot];
+    bool low = stats->heap_size[STATS_LOW] > 0
+                   ? x <= stats->values[stats->heap[STATS_LOW][0]]
+                   : stats->heap_size[STATS_HIGH] == 0 || x < stats->values[stats->heap[STATS_HIGH][0]];
+    __heap_insert(stats, low ? STATS_LOW : STATS_HIGH, slot);
+    __median_rebalance(stats);
+}
+
+/**
+ * @brief Keeps the lower half the same size as the upper half, or one bigger
+ */
+static void __median_rebalance(stats_t *stats) {
+    while (stats->heap_size[STATS_LOW] > stats->heap_size[STATS_HIGH] + 1) {
+        __heap_insert(stats, STATS_HIGH, __heap_remove(stats, STATS_LOW, 0));
+    }
+    while (stats->heap_size[STATS_HIGH] > stats->heap_size[STATS_LOW]) {
+        __heap_insert(stats, STATS_LOW, __heap_remove(stats, STATS_HIGH, 0));
+    }
+}
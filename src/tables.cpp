@@ -0,0 +1,8 @@
+#include "tables.h"
+
+// Generated at compile time, see tables.h
+constexpr quarter_sine_table<FFT_MAX_BITS> QUARTER_SINE;
+constexpr window_tables<FFT_MAX_BITS> WINDOW_TABLES;
+constexpr note_ratio_table NOTE_RATIOS;
+constexpr log2_table LOG2_TABLE;
+constexpr exp2_table EXP2_TABLE;
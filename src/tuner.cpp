@@ -8,6 +8,16 @@ static uint32_t __note2freq(display_note_t note, uint8_t octave);
 
 // Global variables
 struct display_tuner_t *tuner;
+uint8_t tuner_preset = 0;
+
+// Shorter frames halve the latency and double the bin width, which the high strings can afford
+const tuner_preset_t TUNER_PRESETS[] = {
+    {ENGINE_FFT, CAPTURE_BITS, "tuner: FFT engine"},
+    {ENGINE_FFT, CAPTURE_BITS - 1, "tuner: FFT engine, short frames"},
+    {ENGINE_YIN, CAPTURE_BITS, "tuner: YIN engine"},
+};
+#define NUM_TUNER_PRESETS (sizeof(TUNER_PRESETS) / sizeof(TUNER_PRESETS[0]))
+static_assert(CAPTURE_BITS - 1 >= FFT_MIN_BITS, "Short frame preset isn't compiled in");
 struct repeating_timer metronome_timer;
 volatile uint8_t metronome_counter;
 
@@ -24,7 +34,7 @@ void tuner_init() {
     tuner->soundback_en = false;
     tuner->soundback_note = NOTE_A;
     tuner->soundback_octave = 4;
-    change_fft_center(tuner->center_frequency);
+    pipeline_set_center(tuner->center_frequency);
     pinMode(PIZEO_PIN, OUTPUT);
 }
 
@@ -39,7 +49,7 @@ void do_tuner(control_output_t *control_output) {
         if (!tuner->display_meme) {
             // Change center_frequency
             tuner->center_frequency += control_output->encoder_movement;
-            change_fft_center(tuner->center_frequency);
+            pipeline_set_center(tuner->center_frequency);
         } else {
             if (tuner->currency == CURRENCY_USD && control_output->encoder_movement < 0) {
                 tuner->currency = CURRENCY_BTC;
@@ -53,22 +63,31 @@ void do_tuner(control_output_t *control_output) {
     }
 
     if (control_output->encoder_but_pressed) {
-        // Doesn't do anything here
+        // Next engine and frame size, core1 picks this up before its next frame
+        tuner_preset                 = (tuner_preset + 1) % NUM_TUNER_PRESETS;
+        const tuner_preset_t *preset = &TUNER_PRESETS[tuner_preset];
+        pipeline_set_fft_size(preset->fft_bits);
+        pipeline_set_engine(preset->engine);
+        LOG_INFO("%s", preset->name);
         control_output->encoder_but_pressed = 0;
     }
 
-    fix15 result = do_fft();
+    // Core1 may have published several results since the last redraw, only the newest matters
+    pitch_result_t result;
+    bool fresh = false;
+    while (pipeline_pop(&result)) fresh = true;
 
-    if (result != 0) {
-        if (result == int2fix15(-1)) {
+    if (fresh) {
+        if (result.frequency == int2fix15(-1)) {
             // Low noise signal.
             tuner->low_noise = true;
         }
 
-        uint8_t index;
-        freq2note(result, &index, &(tuner->cents_deviation));
-        tuner->current_note = __noteindex2displaynote(index);
-        tuner->low_noise    = false;
+        tuner->cents_deviation = result.cents_deviation;
+        tuner->current_note    = __noteindex2displaynote(result.note_index);
+        tuner->low_noise       = false;
+        tuner->sequence        = result.sequence;
+        tuner->captured        = result.captured;
         display_tuner(tuner);
     }
 }
@@ -98,9 +117,7 @@ void do_metronome(control_output_t *control_output) {
                 }
             }
         }
-        char msg[64];
-        sprintf(msg, "metronome: mode %d at %dbpm", tuner->beat, tuner->metronome_bpm);
-        print_msg(msg, DEBUG);
+        LOG_DEBUG("metronome: mode %d at %dbpm", tuner->beat, tuner->metronome_bpm);
 
         control_output->encoder_movement = 0;
 
@@ -187,7 +204,7 @@ void do_soundback(control_output_t *control_output) {
  *
  */
 bool __metronome_irq(struct repeating_timer *t) {
-    print_msg("metronome_irq", DEBUG);
+    LOG_DEBUG("metronome_irq");
     // What kind of tone?
     if (tuner->beat == BEAT_0) {
         tone(PIZEO_PIN, METRONOME_LOW_TONE);
@@ -259,6 +276,9 @@ int64_t __metronome_off(alarm_id_t id, void *user_data) {
  */
 void tuner_new_mode() {
     tuner->mode_sel = 0;
+#ifdef PROFILE
+    profile_resync(); // results pile up unseen on the other screens
+#endif
 }
 
 /**
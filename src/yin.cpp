@@ -0,0 +1,90 @@
+#include "yin.h"
+
+// Private defs
+static inline fix15 __cmndf(uint64_t diff, uint16_t tau, uint64_t running_sum);
+
+/**
+ * @brief Estimates the pitch of the next frame with the YIN algorithm
+ * @remarks Based on de Cheveigné & Kawahara, "YIN, a fundamental frequency estimator
+ *          for speech and music". Works on the same frames as do_fft() and shares its
+ *          smoothing, so the two engines are interchangeable.
+ *
+ * @return fix15 smoothed frequency, 0 if no new frame, -1 if no pitch was found
+ */
+fix15 do_yin() {
+    uint16_t data_error = 0;
+    uint16_t *frame     = fft_next_frame(&data_error);
+    if (frame == NULL) return 0;
+
+    uint32_t rate    = fft_frame_rate();
+    uint16_t length  = fft_frame_length();
+    uint16_t tau_min = rate / YIN_MAX_FREQ;
+    uint16_t tau_max = rate / YIN_MIN_FREQ;
+    uint16_t window  = YIN_WINDOW;
+    if (window > length / 2) window = length / 2;
+    if (tau_max > length - window - 1) tau_max = length - window - 1;
+
+    // Error checking: flags left in bit 15 of an undecimated frame, plus any the decimator found
+    for (uint16_t i = 0; i < length; i++) data_error += frame[i] >> 15;
+    if (data_error) {
+        LOG_WARNING("%d ADC errors detected out of %d samples", data_error, length);
+    }
+
+    // Step 1 & 2: difference function and its cumulative mean normalized form, computed one
+    // lag at a time so only the values around the current lag need keeping
+    fix15 threshold      = float2fix15(YIN_THRESHOLD);
+    uint64_t running_sum = 0;
+    fix15 before         = int2fix15(1); // d'(tau - 2)
+    fix15 best           = int2fix15(1); // d'(tau - 1)
+    fix15 after          = int2fix15(1); // d'(tau)
+    uint16_t tau_best    = 0;
+    for (uint16_t tau = 1; tau <= tau_max; tau++) {
+        uint64_t diff = 0;
+        for (uint16_t j = 0; j < window; j++) {
+            int32_t delta = (int32_t)(frame[j] & 0x7FFF) - (int32_t)(frame[j + tau] & 0x7FFF);
+            diff += (uint32_t)(delta * delta);
+        }
+        running_sum += diff;
+        if (tau < tau_min) continue;
+
+        // Step 3: the first dip under the threshold, followed down to its minimum
+        after = __cmndf(diff, tau, running_sum);
+        if (best < threshold && after >= best) {
+            tau_best = tau - 1;
+            break;
+        }
+        before = best;
+        best   = after;
+    }
+
+    // Aperiodic (noise or silence)
+    if (tau_best == 0) return int2fix15(-1);
+
+    // Step 4: parabolic interpolation of the minimum
+    fix15 delta = 0;
+    fix15 curve = before - 2 * best + after;
+    if (curve > 0) {
+        delta = divide_fix15((before - after) >> 1, curve);
+        delta = constrain(delta, -(int2fix15(1) >> 1), int2fix15(1) >> 1);
+    }
+    fix15 period = int2fix15(tau_best) + delta;
+
+    // rate / period, kept in 64 bits since rate doesn't fit in a fix15
+    fix15 frequency = (fix15)(((int64_t)rate << 30) / period);
+
+    // Step 5: same refinement and smoothing as the FFT engine
+    return fft_smooth(fft_refine(frequency));
+}
+
+/**
+ * @brief Cumulative mean normalized difference d'(tau) = d(tau) * tau / sum(d(1..tau))
+ *
+ * @param diff d(tau)
+ * @param tau lag in samples
+ * @param running_sum sum of d(1..tau)
+ * @return fix15 d'(tau), 1 when the signal is silent
+ */
+static inline fix15 __cmndf(uint64_t diff, uint16_t tau, uint64_t running_sum) {
+    if (running_sum == 0) return int2fix15(1);
+    return (fix15)(((diff * tau) << 15) / running_sum);
+}
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+Expands the binary log records the firmware sends over Serial (see include/log.h).
+
+Each record carries the address of its format string instead of the text, so the
+strings are read back out of the firmware ELF it came from:
+
+    python3 tools/logdecode.py .pio/build/pico/firmware.elf < /dev/ttyACM0
+
+Anything between records, like fatal_error() output, is passed through as is.
+"""
+import re
+import struct
+import sys
+
+SYNC = b"\xf5\x1a"
+HEADER = 12  # sync, level and core, count, format address, timestamp
+LEVELS = {0: "Debug", 1: "Info", 2: "Warning", 3: "Error"}
+SPEC = re.compile(r"%([-+ #0-9.]*)[hlzjtL]*([diuxXocfeEgGsp%])")
+
+
+class Elf:
+    """Just enough of an ELF reader to look up C strings by address"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[5] != 1:
+            sys.exit(f"{path}: not a little endian ELF")
+        wide = self.data[4] == 2
+        if wide:
+            shoff, = struct.unpack_from("<Q", self.data, 0x28)
+            shentsize, shnum = struct.unpack_from("<HH", self.data, 0x3A)
+        else:
+            shoff, = struct.unpack_from("<I", self.data, 0x20)
+            shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+
+        # Allocated sections that hold their contents in the file, as (address, offset, size)
+        self.sections = []
+        for i in range(shnum):
+            base = shoff + i * shentsize
+            if wide:
+                kind, flags, addr, offset, size = struct.unpack_from("<IQQQQ", self.data, base + 4)
+            else:
+                kind, flags, addr, offset, size = struct.unpack_from("<IIIII", self.data, base + 4)
+            if flags & 0x2 and kind != 8 and size > 0:  # SHF_ALLOC, not SHT_NOBITS
+                self.sections.append((addr, offset, size))
+
+    def string(self, address):
+        for addr, offset, size in self.sections:
+            if addr <= address < addr + size:
+                start = offset + address - addr
+                end = self.data.find(b"\0", start, offset + size)
+                return self.data[start:end if end >= 0 else offset + size].decode("utf-8", "replace")
+        return None
+
+
+def expand(elf, address, args):
+    """Same expansion as log_format() on the device"""
+    fmt = elf.string(address)
+    if fmt is None:
+        return f"<unknown format 0x{address:08x}> " + " ".join(f"0x{a:08x}" for a in args)
+
+    args = list(args)
+
+    def convert(match):
+        flags, conversion = match.groups()
+        if conversion == "%":
+            return "%"
+        word = args.pop(0) if args else 0
+        spec = "%" + flags + conversion
+        if conversion in "di":
+            return spec % struct.unpack("<i", struct.pack("<I", word))[0]
+        if conversion in "uxXo":
+            return spec % word
+        if conversion == "c":
+            return spec % chr(word & 0xFF)
+        if conversion in "feEgG":
+            return spec % struct.unpack("<f", struct.pack("<I", word))[0]
+        if conversion == "s":
+            text = elf.string(word) if word else "(null)"
+            return ("%" + flags + "s") % (text if text is not None else f"<0x{word:08x}>")
+        return ("%" + flags + "s") % f"0x{word:x}"
+
+    return SPEC.sub(convert, fmt)
+
+
+def decode(elf, stream, out):
+    buffer = b""
+    while True:
+        chunk = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+        if not chunk:
+            break
+        buffer += chunk
+
+        while True:
+            start = buffer.find(SYNC)
+            if start < 0:
+                # Keep a trailing first sync byte, the rest is plain text
+                keep = 1 if buffer.endswith(SYNC[:1]) else 0
+                out.write(buffer[: len(buffer) - keep].decode("utf-8", "replace"))
+                buffer = buffer[len(buffer) - keep :]
+                break
+            out.write(buffer[:start].decode("utf-8", "replace"))
+            buffer = buffer[start:]
+            if len(buffer) < HEADER:
+                break
+            count = buffer[3]
+            if len(buffer) < HEADER + 4 * count:
+                break
+
+            level, core = buffer[2] & 0xF, buffer[2] >> 4
+            address, time_us = struct.unpack_from("<II", buffer, 4)
+            args = struct.unpack_from(f"<{count}I", buffer, HEADER)
+            text = expand(elf, address, args)
+            out.write(f"{time_us / 1e6:12.6f} core{core} ({LEVELS.get(level, level)}) {text}\n")
+            buffer = buffer[HEADER + 4 * count :]
+        out.flush()
+    out.write(buffer.decode("utf-8", "replace"))
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        sys.exit(f"usage: {sys.argv[0]} firmware.elf [capture]")
+    elf = Elf(sys.argv[1])
+    if len(sys.argv) == 3:
+        with open(sys.argv[2], "rb") as stream:
+            decode(elf, stream, sys.stdout)
+    else:
+        decode(elf, sys.stdin.buffer, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()